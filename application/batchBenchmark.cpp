@@ -0,0 +1,74 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batch_nes.h"
+#include "rom_loader.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Pseudo-random buttons, different on each lane and every few frames
+static u8 Buttons(u32 lane, u32 frame)
+{
+    u32 seed = (lane + 1) * 2654435761u ^ (frame / 8) * 40503u;
+    return u8(seed >> 13);
+}
+
+static double Seconds(Clock::time_point begin)
+{
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Usage: batch_benchmark rom.nes [lanes] [frames]
+// Runs lanes consoles for frames frames, as a BatchNes and as independent Nes
+// objects, and prints the aggregate frames per second of both
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " rom.nes [lanes] [frames]" << std::endl;
+        return 1;
+    }
+    const u32 lanes = argc > 2 ? std::stoul(argv[2]) : 64;
+    const u32 frames = argc > 3 ? std::stoul(argv[3]) : 300;
+    Frankenstein::Rom rom(Frankenstein::RomLoader::GetRom(argv[1]));
+    if (!rom.IsValid()) {
+        std::cerr << "Cannot load the iNES image " << argv[1] << std::endl;
+        return 1;
+    }
+
+    Frankenstein::BatchNes batch(rom, lanes);
+    Clock::time_point begin = Clock::now();
+    for (u32 frame = 0; frame < frames; ++frame) {
+        for (u32 lane = 0; lane < lanes; ++lane) {
+            batch.SetButtons(lane, Buttons(lane, frame));
+        }
+        batch.StepAll();
+    }
+    const double batchTime = Seconds(begin);
+
+    std::vector<std::unique_ptr<Frankenstein::Nes>> consoles;
+    for (u32 lane = 0; lane < lanes; ++lane) {
+        consoles.emplace_back(new Frankenstein::Nes(rom));
+    }
+    begin = Clock::now();
+    for (u32 frame = 0; frame < frames; ++frame) {
+        for (u32 lane = 0; lane < lanes; ++lane) {
+            const u8 buttons = Buttons(lane, frame);
+            for (u8 button = 0; button < 8; ++button) {
+                consoles[lane]->pad1.buttons[button] = (buttons >> button) & 1;
+            }
+            consoles[lane]->RunFrame();
+        }
+    }
+    const double aloneTime = Seconds(begin);
+
+    const double total = double(lanes) * frames;
+    std::cout << lanes << " lanes, " << frames << " frames" << std::endl;
+    std::cout << "sizeof(Nes):     " << sizeof(Frankenstein::Nes) << " bytes, budget "
+              << Frankenstein::Nes::SizeBudget << std::endl;
+    std::cout << "BatchNes:        " << total / batchTime << " fps" << std::endl;
+    std::cout << "independent Nes: " << total / aloneTime << " fps" << std::endl;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "frame_converter.h"
+#include "nes.h"
+#include "rom_loader.h"
+
+using Clock = std::chrono::steady_clock;
+using Frankenstein::PixelFormat;
+
+static const char* FormatName(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::RGBA8888:
+        return "RGBA8888";
+    case PixelFormat::XRGB8888:
+        return "XRGB8888";
+    case PixelFormat::RGB565:
+        return "RGB565";
+    case PixelFormat::Gray8:
+        return "Gray8";
+    case PixelFormat::YUV420:
+        return "YUV420";
+    default:
+        return "?";
+    }
+}
+
+// Usage: format_benchmark rom.nes [frames]
+// Emulates 120 frames of the ROM, then converts the last one frames times to
+// each pixel format and prints the time per frame of each
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " rom.nes [frames]" << std::endl;
+        return 1;
+    }
+    const u32 frames = argc > 2 ? std::stoul(argv[2]) : 2000;
+    Frankenstein::Rom rom(Frankenstein::RomLoader::GetRom(argv[1]));
+    if (!rom.IsValid()) {
+        std::cerr << "Cannot load the iNES image " << argv[1] << std::endl;
+        return 1;
+    }
+    Frankenstein::Nes nes(rom);
+    for (u32 frame = 0; frame < 120; ++frame) {
+        nes.RunFrame();
+    }
+
+    std::cout << frames << " conversions of a frame" << std::endl;
+    for (u8 f = 0; f < u8(PixelFormat::Count); ++f) {
+        const Frankenstein::FrameConverter converter{ PixelFormat(f) };
+        std::vector<u8> out(converter.FrameBytes());
+        const Clock::time_point begin = Clock::now();
+        for (u32 frame = 0; frame < frames; ++frame) {
+            converter.Convert(nes.ppu.front, out.data());
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        std::cout << std::left << std::setw(10) << FormatName(converter.GetFormat()) << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(8) << seconds * 1e6 / frames << " us/frame "
+                  << std::setw(8) << frames * double(out.size()) / seconds / 1e6 << " MB/s" << std::endl;
+    }
+    return 0;
+}
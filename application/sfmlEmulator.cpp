@@ -1,17 +1,14 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
 
-#include <bitset>
-#include <chrono>
-#include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "cpu.h"
+#include "frame_converter.h"
 #include "nes.h"
 #include "gamepad.h"
 #include "rom_loader.h"
@@ -26,45 +23,14 @@ bool isRunning = true;
 
 void emulatorMain(Frankenstein::Nes &nes)
 {
-    std::ofstream out("debug2.txt", std::ios::out | std::ios::binary);
-    out << "EX.TIME|PPU|PC  |SVABDIZC|A |X |Y |Instruction| Hex data" << std::endl;
-
+    const Frankenstein::FrameConverter converter(Frankenstein::PixelFormat::RGBA8888);
+    std::vector<sf::Uint8> pixels(converter.FrameBytes());
     while (isRunning) {
-        std::stringstream instString;
-        auto op = nes.cpu.OpCode();
-        auto instr = nes.cpu.instructions[op];
-        instString << std::setfill('0') << std::setw(3) << std::hex
-                   << (unsigned int)nes.ppu.Cycle << "|";
-        instString << std::setfill('0') << std::setw(4) << std::hex
-                   << (unsigned int)nes.cpu.registers.PC << "|";
-        instString << std::bitset<8>(nes.cpu.registers.P) << "|";
-        instString << std::setfill('0') << std::setw(2) << std::hex
-                   << (unsigned int)nes.cpu.registers.A << "|";
-        instString << std::setfill('0') << std::setw(2) << std::hex
-                   << (unsigned int)nes.cpu.registers.X << "|";
-        instString << std::setfill('0') << std::setw(2) << std::hex
-                   << (unsigned int)nes.cpu.registers.Y << "|";
-        instString << std::setfill(' ') << std::setw(11)
-                   << instr.name << "| ";
-
-        int max = instr.size == 0 ? 3 : instr.size;
-        for (int i = 0; i < max; i++) {
-            instString << std::setfill('0') << std::setw(2) << std::hex << (unsigned int)nes.cpu.Operand(i);
-            instString << " ";
-        }
-
-        auto begin = std::chrono::steady_clock::now();
-        nes.Step();
-        auto end = std::chrono::steady_clock::now();
-
-        out << std::setfill(' ') << std::setw(5) << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "ns|";
-        out << instString.str();
-        out << std::endl;
+        nes.RunFrame();
+        converter.Convert(nes.ppu.front, pixels.data());
 
-        if (nes.ppu.vblankOccured) {
-            std::lock_guard<std::mutex> guard(imageMutex);
-            screen.update((const sf::Uint8*)nes.ppu.front);
-        }
+        std::lock_guard<std::mutex> guard(imageMutex);
+        screen.update(pixels.data());
     }
 }
 
@@ -80,6 +46,10 @@ int main(int argc, char* argv[])
     std::string file(argv[1]);
     //Frankenstein::Rom rom(Frankenstein::StaticRom::raw, Frankenstein::StaticRom::length);// Frankenstein::RomLoader::GetRom(file));
     Frankenstein::Rom rom(Frankenstein::RomLoader::GetRom(file));
+    if (!rom.IsValid()) {
+        std::cerr << "Cannot load the iNES image " << file << std::endl;
+        return 1;
+    }
     Frankenstein::Nes nes(rom);
     std::thread emulatorThr(emulatorMain, std::ref(nes));
 
@@ -165,5 +135,7 @@ int main(int argc, char* argv[])
 
     emulatorThr.join();
 
+    std::cout << "Skipped idle cycles: " << nes.idleLoop.skippedCycles << " of " << nes.clock / 3 << std::endl;
+
     return 0;
 }
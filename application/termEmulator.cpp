@@ -1,4 +1,5 @@
 #include <fstream>
+#include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <chrono>
@@ -9,49 +10,70 @@
 #include "memory.h"
 #include "rom_loader.h"
 
+// Executes one instruction and writes it to the trace
+static void TraceStep(Frankenstein::Nes& nes, std::ofstream& out)
+{
+    std::stringstream instString;
+    auto op = nes.cpu.OpCode();
+    auto instr = nes.cpu.instructions[op];
+    instString << std::setfill('0') << std::setw(4) << std::hex
+               << (unsigned int)nes.cpu.registers.PC << "|";
+    instString << std::bitset<8>(nes.cpu.GetStatus()) << "|";
+    instString << std::setfill('0') << std::setw(2) << std::hex
+               << (unsigned int)nes.cpu.registers.A << "|";
+    instString << std::setfill('0') << std::setw(2) << std::hex
+               << (unsigned int)nes.cpu.registers.X << "|";
+    instString << std::setfill('0') << std::setw(2) << std::hex
+               << (unsigned int)nes.cpu.registers.Y << "|";
+    instString << std::setfill(' ') << std::setw(11)
+               << instr.name << "| ";
+
+    int max = instr.size == 0 ? 3 : instr.size;
+    for(int i = 0; i < max; i++) {
+        instString << std::setfill('0') << std::setw(2) << std::hex << (unsigned int)nes.cpu.Operand(i);
+        instString << " ";
+    }
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    nes.Step();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    out << std::setfill(' ') << std::setw(5) << std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count() << "ns|";
+    out << instString.str();
+    out << std::endl;
+}
+
+// Usage: termEmulator rom.nes [--trace]
+// --trace writes every instruction executed to debug2.txt, otherwise the
+// emulator runs a frame at a time
 int main(int argc, char* argv[])
 {
     std::string file(argv[1]);
+    bool trace = argc > 2 && std::string(argv[2]) == "--trace";
     Frankenstein::Rom rom(Frankenstein::RomLoader::GetRom(file));
+    if (!rom.IsValid()) {
+        std::cerr << "Cannot load the iNES image " << file << std::endl;
+        return 1;
+    }
     Frankenstein::Nes nes(rom);
 
     std::ofstream out("debug2.txt", std::ios::out | std::ios::binary);
-    out << "EX.TIME|PC  |SVABDIZC|A |X |Y |Instruction| Hex data" << std::endl;
+    if (trace) {
+        // one line per instruction, the fused pairs are split
+        nes.cpu.fusePairs = false;
+        out << "EX.TIME|PC  |SVABDIZC|A |X |Y |Instruction| Hex data" << std::endl;
+    }
 
     bool isTestDone = false;
 
     while (!isTestDone)
     {
-        std::stringstream instString;
-        auto op = nes.cpu.OpCode();
-        auto instr = nes.cpu.instructions[op];
-        instString << std::setfill('0') << std::setw(4) << std::hex
-                   << (unsigned int)nes.cpu.registers.PC << "|";
-        instString << std::bitset<8>(nes.cpu.registers.P) << "|";
-        instString << std::setfill('0') << std::setw(2) << std::hex
-                   << (unsigned int)nes.cpu.registers.A << "|";
-        instString << std::setfill('0') << std::setw(2) << std::hex
-                   << (unsigned int)nes.cpu.registers.X << "|";
-        instString << std::setfill('0') << std::setw(2) << std::hex
-                   << (unsigned int)nes.cpu.registers.Y << "|";
-        instString << std::setfill(' ') << std::setw(11)
-                   << instr.name << "| ";
-
-        int max = instr.size == 0 ? 3 : instr.size;
-        for(int i = 0; i < max; i++) {
-            instString << std::setfill('0') << std::setw(2) << std::hex << (unsigned int)nes.cpu.Operand(i);
-            instString << " ";
+        if (trace) {
+            TraceStep(nes, out);
+        } else {
+            nes.RunFrame();
         }
 
-        auto begin = std::chrono::high_resolution_clock::now();
-        nes.Step();
-        auto end = std::chrono::high_resolution_clock::now();
-
-        out << std::setfill(' ') << std::setw(5) << std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count() << "ns|";
-        out << instString.str();
-        out << std::endl;
-
-
         // The test status is written to $6000. $80 means the test is running, $81
         // means the test needs the reset button pressed, but delayed by at least
         // 100 msec from now. $00-$7F means the test has completed and given that
@@ -77,6 +99,8 @@ int main(int argc, char* argv[])
             }
             while(c != '\0');
 
+            out << "\nSkipped idle cycles: " << std::dec << nes.idleLoop.skippedCycles << "\n";
+
             isTestDone = true;
         }
     }
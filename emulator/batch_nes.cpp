@@ -0,0 +1,36 @@
+#include "batch_nes.h"
+
+using namespace Frankenstein;
+
+BatchNes::BatchNes(Rom& rom, u32 lanes)
+    : count(lanes)
+    , consoles(new Nes*[lanes])
+{
+    for (u32 lane = 0; lane < count; ++lane) {
+        consoles[lane] = new Nes(rom);
+        consoles[lane]->cpu.decodeCache = consoles[0]->cpu.ownDecodeCache;
+    }
+}
+
+BatchNes::~BatchNes()
+{
+    for (u32 lane = 0; lane < count; ++lane) {
+        delete consoles[lane];
+    }
+    delete[] consoles;
+}
+
+void BatchNes::SetButtons(u32 lane, u8 buttons)
+{
+    Gamepad& pad = consoles[lane]->pad1;
+    for (u8 button = Gamepad::A; button <= Gamepad::Right; ++button) {
+        pad.buttons[button] = (buttons >> button) & 1;
+    }
+}
+
+void BatchNes::StepAll()
+{
+    for (u32 lane = 0; lane < count; ++lane) {
+        consoles[lane]->RunFrame();
+    }
+}
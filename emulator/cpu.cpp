@@ -5,61 +5,89 @@ using namespace Frankenstein;
 
 using Mode = Frankenstein::Addressing;
 
-Cpu::Cpu(Nes& pNes)
-    : nes(pNes)
-{
-    this->LoadRom(nes.rom);
-    this->Reset();
-}
+namespace {
 
-void Cpu::LoadRom(const Rom& rom)
-{
-    const iNesHeader header = rom.GetHeader();
-    int prgRomBanks = header.prgRomBanks;
-    int trainerOffset = rom.GetTrainerOffset();
-    int prgRomBanksLocation = Rom::HeaderSize + trainerOffset;
+// Constant handlers and sizes, so the fused handlers inline both instructions
+constexpr Cpu::Instruction Handlers[256] = {
+#define CPU_OPCODE(opcode, handler, size) &Cpu::handler,
+#include "cpu_opcodes.h"
+#undef CPU_OPCODE
+};
 
-    switch (prgRomBanks) {
-    case 1:
-        nes.ram.Copy(rom.GetRaw() + prgRomBanksLocation, Frankenstein::ADDR_PRG_ROM_LOWER_BANK, PRGROM_BANK_SIZE);
-        nes.ram.Copy(rom.GetRaw() + prgRomBanksLocation, Frankenstein::ADDR_PRG_ROM_UPPER_BANK, PRGROM_BANK_SIZE);
-        break;
-    case 2:
-        nes.ram.Copy(rom.GetRaw() + prgRomBanksLocation, Frankenstein::ADDR_PRG_ROM_LOWER_BANK, PRGROM_BANK_SIZE);
-        nes.ram.Copy(rom.GetRaw() + prgRomBanksLocation + PRGROM_BANK_SIZE, Frankenstein::ADDR_PRG_ROM_UPPER_BANK, PRGROM_BANK_SIZE);
-        break;
-    default: //TODO: implement multiple PRG-ROM banks
-        break;
+constexpr u8 Sizes[256] = {
+#define CPU_OPCODE(opcode, handler, size) size,
+#include "cpu_opcodes.h"
+#undef CPU_OPCODE
+};
+
+/**
+ * Number of operand bytes of opcode, including the instructions setting PC
+ */
+u8 OperandLength(const u8 opcode)
+{
+    switch (opcode) {
+    case 0x20: // JSR
+    case 0x4C: // JMP abs
+    case 0x6C: // JMP ind
+        return 2;
     }
+    return Sizes[opcode] != 0 ? Sizes[opcode] - 1 : 0;
+}
+
+}
+
+const Cpu::InstructionInfo Cpu::instructions[256] = {
+#define CPU_OPCODE(opcode, handler, size) { #handler, &Cpu::handler, size },
+#include "cpu_opcodes.h"
+#undef CPU_OPCODE
+};
+
+Cpu::Cpu(Nes& pNes)
+    : registers() // A, X and Y are 0 at power on
+    , cycles(0)
+    , fusePairs(true)
+    , nmiOccurred(false)
+    , decodeCache(ownDecodeCache)
+    , nes(pNes)
+    , ownDecodeCache()
+{
     this->Reset();
 }
 
 void Cpu::Reset()
 {
     this->registers.PC = (nes.ram[0xFFFC] | nes.ram[0xFFFD] << 8);
-    this->registers.P = 0b00100100;
+    SetStatus(0b00100100);
     this->registers.SP = 0xFF;
     this->stall = 0;
 }
 
-void Cpu::Step()
+u8 Cpu::GetStatus() const
 {
-    if (this->stall > 0) {
-        this->stall--;
-        this->cycles = 1;
-        return;
-    }
-    if (nmiOccurred) {
-        this->cycles = NMI();
-        this->nmiOccurred = false;
-    } else {
-        this->currentOpcode = OpCode();
-        this->previousPC = this->registers.PC;
-        auto instruction = this->instructions[this->currentOpcode];
-        this->cycles = (this->*(instruction.fct))();
-        this->registers.PC += instruction.size;
-        this->nextOpcode = OpCode();
+    u8 status = this->registers.P;
+    AssignBit<static_cast<int>(Flags::Z)>(status, this->zeroResult == 0);
+    AssignBit<static_cast<int>(Flags::S)>(status, CheckBit<8>(this->signResult));
+    return status;
+}
+
+void Cpu::SetStatus(const u8 status)
+{
+    this->registers.P = status;
+    this->zeroResult = !CheckBit<static_cast<int>(Flags::Z)>(status);
+    this->signResult = status & 0x80;
+}
+
+u8 Cpu::Step(const u64 budget)
+{
+    const DecodedInstruction& instruction = Decode(this->registers.PC);
+    this->currentOpcode = instruction.opcode;
+    this->operand = instruction.operand;
+    this->previousPC = this->registers.PC;
+    if (instruction.fusion != Fusion::None && this->fusePairs) {
+        return ExecuteFused(instruction, budget);
     }
+    this->cycles = Execute(this->currentOpcode);
+    return this->cycles;
 }
 
 void Cpu::PushOnStack(u8 value)
@@ -80,7 +108,7 @@ u8 Cpu::PopFromStack()
 */
 u8 Cpu::OpCode()
 {
-    return nes.ram[this->registers.PC];
+    return Decode(this->registers.PC).opcode;
 }
 
 /**
@@ -88,7 +116,96 @@ u8 Cpu::OpCode()
 */
 u8 Cpu::Operand(int number)
 {
-    return nes.ram[this->registers.PC + number];
+    const DecodedInstruction& instruction = Decode(this->registers.PC);
+    return number == 0 ? instruction.opcode : u8(instruction.operand >> (8 * (number - 1)));
+}
+
+/**
+ * Branches, jumps, returns and interrupts end a basic block
+ */
+static bool EndsBlock(const u8 opcode, const u8 size)
+{
+    return size == 0 || (opcode & 0x1F) == 0x10;
+}
+
+/**
+ * The pair starting with first, when second follows it
+ */
+static Cpu::Fusion Fuse(const u8 first, const u8 second, const u16 secondOperand)
+{
+#define CPU_OPCODE(opcode, handler, size)
+#define CPU_FUSED(name, firstOpcode, secondOpcode) \
+    if (first == firstOpcode && second == secondOpcode) { \
+        fusion = Cpu::Fusion::name;                       \
+    }
+    Cpu::Fusion fusion = Cpu::Fusion::None;
+#include "cpu_opcodes.h"
+#undef CPU_FUSED
+#undef CPU_OPCODE
+
+    // the second instruction runs before the master clock is advanced, it
+    // may only store to the internal RAM, which does not sync the PPU
+    if (fusion == Cpu::Fusion::LDA_ABS_STA_ABS && secondOperand >= 0x2000) {
+        return Cpu::Fusion::None;
+    }
+    return fusion;
+}
+
+const Cpu::DecodedInstruction& Cpu::Decode(const u16 pc)
+{
+    const u8* page = nes.ram.bus.ReadPage(pc);
+    DecodedInstruction& cached = this->decodeCache[pc & (DecodeCacheSize - 1)];
+    if (cached.pc == pc && cached.page == page && page != nullptr) {
+        return cached;
+    }
+
+    constexpr u16 PageMask = NES_PAGE_SIZE - 1;
+    if (page == nullptr || nes.ram.bus.WritePage(pc) != nullptr || (pc & PageMask) > PageMask - 2) {
+        DecodedInstruction& scratch = this->decodedScratch;
+        scratch.page = nullptr;
+        scratch.pc = pc;
+        scratch.fusion = Fusion::None;
+        if (page != nullptr && (pc & PageMask) <= PageMask - 2) {
+            // RAM: fetched from the host page on each execution
+            scratch.opcode = page[pc & PageMask];
+            scratch.operand = LoadWord(page + (pc & PageMask) + 1);
+        } else {
+            // across the end of a page or from I/O: only the bytes of the
+            // instruction are read through the bus, reading more could
+            // trigger the side effects of a register
+            scratch.opcode = nes.ram[pc];
+            const u8 length = OperandLength(scratch.opcode);
+            const u8 low = length > 0 ? u8(nes.ram[u16(pc + 1)]) : 0;
+            const u8 high = length > 1 ? u8(nes.ram[u16(pc + 2)]) : 0;
+            scratch.operand = NesMemory::FromValues(low, high);
+        }
+        return scratch;
+    }
+
+    // Decode the basic block starting at pc, up to the end of the page
+    u16 address = pc;
+    DecodedInstruction* previous = nullptr;
+    do {
+        const u8* code = page + (address & PageMask);
+        DecodedInstruction& entry = this->decodeCache[address & (DecodeCacheSize - 1)];
+        entry.page = page;
+        entry.pc = address;
+        entry.opcode = code[0];
+        entry.operand = LoadWord(code + 1);
+        entry.fusion = Fusion::None;
+        if (previous != nullptr) {
+            previous->fusion = Fuse(previous->opcode, entry.opcode, entry.operand);
+            previous->fusedOperand = entry.operand;
+        }
+        previous = &entry;
+        const u8 size = this->instructions[entry.opcode].size;
+        if (EndsBlock(entry.opcode, size)) {
+            break;
+        }
+        address += size;
+    } while ((address & ~PageMask) == (pc & ~PageMask) && (address & PageMask) <= PageMask - 2);
+
+    return cached;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -98,8 +215,7 @@ u8 Cpu::Operand(int number)
 void Cpu::AND(const u8 value)
 {
     this->registers.A &= value;
-    Set<Flags::Z>(CheckZero(this->registers.A));
-    Set<Flags::S>(CheckSign(this->registers.A));
+    SetZeroAndSign(this->registers.A);
 }
 
 void Cpu::ASL(u8& value)
@@ -107,8 +223,7 @@ void Cpu::ASL(u8& value)
     // 0 is shifted into bit 0 and the original bit 7 is shifted into the Carry.
     Set<Flags::C>(CheckBit<8>(value));
     value <<= 1;
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
 }
 
 void Cpu::ASL(const Memory value)
@@ -129,8 +244,7 @@ void Cpu::BIT(const u8 value)
 void Cpu::EOR(const u8 value)
 {
     this->registers.A ^= value;
-    Set<Flags::Z>(CheckZero(this->registers.A));
-    Set<Flags::S>(CheckSign(this->registers.A));
+    SetZeroAndSign(this->registers.A);
 }
 
 void Cpu::LSR(u8& value)
@@ -138,8 +252,7 @@ void Cpu::LSR(u8& value)
     // 0 is shifted into bit 7 and the original bit 0 is shifted into the Carry.
     Set<Flags::C>(CheckBit<1>(value));
     value >>= 1;
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
 }
 
 void Cpu::LSR(const Memory value)
@@ -152,8 +265,7 @@ void Cpu::LSR(const Memory value)
 void Cpu::ORA(const u8 value)
 {
     this->registers.A |= value;
-    Set<Flags::Z>(CheckZero(this->registers.A));
-    Set<Flags::S>(CheckSign(this->registers.A));
+    SetZeroAndSign(this->registers.A);
 }
 
 void Cpu::ROL(u8& value)
@@ -162,8 +274,7 @@ void Cpu::ROL(u8& value)
     Set<Flags::C>(CheckBit<8>(value));
     value <<= 1;
     AssignBit<1>(value, carry);
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
 }
 
 void Cpu::ROL(const Memory value)
@@ -179,8 +290,7 @@ void Cpu::ROR(u8& value)
     Set<Flags::C>(CheckBit<1>(value));
     value >>= 1;
     AssignBit<8>(value, carry);
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
 }
 
 void Cpu::ROR(const Memory value)
@@ -199,8 +309,7 @@ void Cpu::ADC(const u8 value)
     u16 result = value + this->registers.A + Get<Flags::C>();
     u8 truncResult = static_cast<u8>(result);
 
-    Set<Flags::Z>(CheckZero(truncResult));
-    Set<Flags::S>(CheckSign(truncResult));
+    SetZeroAndSign(truncResult);
     Set<Flags::C>(CheckBit<9, u16>(result));
     Set<Flags::V>(CheckOverflow<>(this->registers.A, value, truncResult, true));
 
@@ -210,8 +319,7 @@ void Cpu::ADC(const u8 value)
 void Cpu::DEC(u8& value)
 {
     value -= 1;
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
 }
 
 void Cpu::DEC(const Memory value)
@@ -224,8 +332,7 @@ void Cpu::DEC(const Memory value)
 void Cpu::INC(u8& value)
 {
     value += 1;
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
 }
 
 void Cpu::INC(const Memory value)
@@ -240,8 +347,7 @@ void Cpu::SBC(const u8 value)
     s16 result = this->registers.A - value - (1 - Get<Flags::C>());
     u8 truncResult = static_cast<u8>(result);
 
-    Set<Flags::Z>(CheckZero(truncResult));
-    Set<Flags::S>(CheckSign(truncResult));
+    SetZeroAndSign(truncResult);
     Set<Flags::C>(result >= 0);
     Set<Flags::V>(CheckOverflow<>(this->registers.A, value, truncResult, false));
     this->registers.A = truncResult;
@@ -254,22 +360,19 @@ void Cpu::SBC(const u8 value)
 void Cpu::LDA(const u8 value)
 {
     this->registers.A = value;
-    Set<Flags::Z>(CheckZero(this->registers.A));
-    Set<Flags::S>(CheckSign(this->registers.A));
+    SetZeroAndSign(this->registers.A);
 }
 
 void Cpu::LDX(const u8 value)
 {
     this->registers.X = value;
-    Set<Flags::Z>(CheckZero(this->registers.X));
-    Set<Flags::S>(CheckSign(this->registers.X));
+    SetZeroAndSign(this->registers.X);
 }
 
 void Cpu::LDY(const u8 value)
 {
     this->registers.Y = value;
-    Set<Flags::Z>(CheckZero(this->registers.Y));
-    Set<Flags::S>(CheckSign(this->registers.Y));
+    SetZeroAndSign(this->registers.Y);
 }
 
 void Cpu::STA(const Memory value)
@@ -295,7 +398,7 @@ void Cpu::STY(const Memory value)
 u8 Cpu::BPL()
 {
     if (!Get<Flags::S>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -307,7 +410,7 @@ u8 Cpu::BPL()
 u8 Cpu::BMI()
 {
     if (Get<Flags::S>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -319,7 +422,7 @@ u8 Cpu::BMI()
 u8 Cpu::BVC()
 {
     if (!Get<Flags::V>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -331,7 +434,7 @@ u8 Cpu::BVC()
 u8 Cpu::BVS()
 {
     if (Get<Flags::V>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -343,7 +446,7 @@ u8 Cpu::BVS()
 u8 Cpu::BCC()
 {
     if (!Get<Flags::C>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -355,7 +458,7 @@ u8 Cpu::BCC()
 u8 Cpu::BCS()
 {
     if (Get<Flags::C>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -367,7 +470,7 @@ u8 Cpu::BCS()
 u8 Cpu::BNE()
 {
     if (!Get<Flags::Z>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -379,7 +482,7 @@ u8 Cpu::BNE()
 u8 Cpu::BEQ()
 {
     if (Get<Flags::Z>()) {
-        s8 offset = Operand(1);
+        s8 offset = OperandByte();
         auto pageCrossed = NesMemory::IsPageCrossed(this->registers.PC + 2, this->registers.PC + offset);
         this->registers.PC += offset;
         return 3 + pageCrossed;
@@ -398,64 +501,56 @@ u8 Cpu::TAX()
 {
     auto& value = this->registers.A;
     this->registers.X = value;
-    Set<Flags::Z>(CheckZero(this->registers.X));
-    Set<Flags::S>(CheckSign(this->registers.X));
+    SetZeroAndSign(this->registers.X);
     return 2;
 }
 
 u8 Cpu::TXA()
 {
     this->registers.A = this->registers.X;
-    Set<Flags::Z>(CheckZero(this->registers.A));
-    Set<Flags::S>(CheckSign(this->registers.A));
+    SetZeroAndSign(this->registers.A);
     return 2;
 }
 
 u8 Cpu::DEX()
 {
     this->registers.X -= 1;
-    Set<Flags::Z>(CheckZero(this->registers.X));
-    Set<Flags::S>(CheckSign(this->registers.X));
+    SetZeroAndSign(this->registers.X);
     return 2;
 }
 
 u8 Cpu::INX()
 {
     this->registers.X += 1;
-    Set<Flags::Z>(CheckZero(this->registers.X));
-    Set<Flags::S>(CheckSign(this->registers.X));
+    SetZeroAndSign(this->registers.X);
     return 2;
 }
 
 u8 Cpu::TAY()
 {
     this->registers.Y = this->registers.A;
-    Set<Flags::Z>(CheckZero(this->registers.Y));
-    Set<Flags::S>(CheckSign(this->registers.Y));
+    SetZeroAndSign(this->registers.Y);
     return 2;
 }
 
 u8 Cpu::TYA()
 {
     this->registers.A = this->registers.Y;
-    Set<Flags::Z>(CheckZero(this->registers.A));
-    Set<Flags::S>(CheckSign(this->registers.A));
+    SetZeroAndSign(this->registers.A);
     return 2;
 }
 
 u8 Cpu::DEY()
 {
     this->registers.Y -= 1;
-    Set<Flags::Z>(CheckZero(this->registers.Y));
-    Set<Flags::S>(CheckSign(this->registers.Y));
+    SetZeroAndSign(this->registers.Y);
     return 2;
 }
 
 u8 Cpu::INY()
 {
     this->registers.Y += 1;
-    Set<Flags::Z>(CheckZero(this->registers.Y));
-    Set<Flags::S>(CheckSign(this->registers.Y));
+    SetZeroAndSign(this->registers.Y);
     return 2;
 }
 
@@ -473,8 +568,7 @@ u8 Cpu::TXS()
 u8 Cpu::TSX()
 {
     this->registers.X = this->registers.SP;
-    Set<Flags::Z>(CheckZero(this->registers.X));
-    Set<Flags::S>(CheckSign(this->registers.X));
+    SetZeroAndSign(this->registers.X);
     return 2;
 }
 
@@ -490,15 +584,14 @@ u8 Cpu::PLA()
 {
     auto value = PopFromStack();
     this->registers.A = value;
-    Set<Flags::Z>(CheckZero(value));
-    Set<Flags::S>(CheckSign(value));
+    SetZeroAndSign(value);
     return 4;
 }
 
 // Push Processor Status
 u8 Cpu::PHP()
 {
-    u8 copy = this->registers.P;
+    u8 copy = GetStatus();
     SetBit<5>(copy);
     SetBit<6>(copy);
     PushOnStack(copy);
@@ -511,7 +604,7 @@ u8 Cpu::PLP()
     u8 temp = PopFromStack();
     ClearBit<5>(temp);
     ClearBit<6>(temp);
-    this->registers.P = temp;
+    SetStatus(temp);
     return 4;
 }
 
@@ -534,6 +627,13 @@ u8 Cpu::NMI()
     return 7;
 }
 
+u8 Cpu::IRQ()
+{
+    Interrupt();
+    this->registers.PC = (nes.ram[0xFFFE] | nes.ram[0xFFFF] << 8);
+    return 7;
+}
+
 u8 Cpu::BRK()
 {
     this->registers.PC += 2;
@@ -549,7 +649,7 @@ void Cpu::JMP(const u16 value)
 
 u8 Cpu::JSR()
 {
-    auto address = NesMemory::Absolute(Operand(1), Operand(2));
+    auto address = this->operand;
     this->registers.PC += 2;
     PushOnStack((this->registers.PC >> 8) & 0xFF); /* Push return address onto the stack. */
     PushOnStack(this->registers.PC & 0xFF);
@@ -559,7 +659,7 @@ u8 Cpu::JSR()
 
 u8 Cpu::RTI()
 {
-    this->registers.P = (PopFromStack() & 0xEF) | 0x20;
+    SetStatus((PopFromStack() & 0xEF) | 0x20);
     u8 low = PopFromStack();
     u8 high = PopFromStack();
     u16 address = u16(low) | (u16(high) << 8);
@@ -584,24 +684,21 @@ void Cpu::CMP(const u8 value)
 {
     u16 result = this->registers.A - value;
     Set<Flags::C>(this->registers.A >= value);
-    Set<Flags::S>(CheckSign(result));
-    Set<Flags::Z>(this->registers.A == value);
+    SetZeroAndSign(static_cast<u8>(result));
 }
 
 void Cpu::CPX(const u8 value)
 {
     u16 result = this->registers.X - value;
     Set<Flags::C>(this->registers.X >= value);
-    Set<Flags::S>(CheckSign(result));
-    Set<Flags::Z>(this->registers.X == value);
+    SetZeroAndSign(static_cast<u8>(result));
 }
 
 void Cpu::CPY(const u8 value)
 {
     u16 result = this->registers.Y - value;
     Set<Flags::C>(this->registers.Y >= value);
-    Set<Flags::S>(CheckSign(result));
-    Set<Flags::Z>(this->registers.Y == value);
+    SetZeroAndSign(static_cast<u8>(result));
 }
 
 u8 Cpu::CLC()
@@ -664,733 +761,169 @@ u8 Cpu::UNIMP()
 /// Operations variant with addressing
 ////////////////////////////////////////////////////////////////////////////////
 
-/// Logical OR
-/// 2 bytes; 6 cycles
-u8 Cpu::ORA_IND_X()
-{
-    ORA(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-/// 2 bytes; 3 cycles
-u8 Cpu::ORA_ZP()
-{
-    ORA(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::ASL_ZP()
-{
-    ASL(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 5;
-}
-
-u8 Cpu::ORA_IMM()
-{
-    ORA(Operand(1));
-    return 2;
-}
-
-u8 Cpu::ASL_ACC()
-{
-    ASL(this->registers.A);
-    return 2;
-}
-
-u8 Cpu::ORA_ABS()
-{
-    ORA(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::ASL_ABS()
-{
-    ASL(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 6;
-}
-
-u8 Cpu::ORA_IND_Y()
-{
-    ORA(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::ORA_ZP_X()
-{
-    ORA(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::ASL_ZP_X()
-{
-    ASL(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::ORA_ABS_Y()
-{
-    ORA(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::ORA_ABS_X()
-{
-    ORA(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::ASL_ABS_X()
-{
-    ASL(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 7;
-}
-
-u8 Cpu::AND_IND_X()
-{
-    AND(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::BIT_ZP()
-{
-    BIT(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::AND_ZP()
-{
-    AND(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::ROL_ZP()
-{
-    ROL(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 5;
-}
-
-u8 Cpu::AND_IMM()
-{
-    AND(Operand(1));
-    return 2;
-}
-
-u8 Cpu::ROL_ACC()
-{
-    ROL(this->registers.A);
-    return 2;
-}
-
-u8 Cpu::BIT_ABS()
-{
-    BIT(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::AND_ABS()
-{
-    AND(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::ROL_ABS()
-{
-    ROL(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 6;
-}
-
-u8 Cpu::AND_IND_Y()
-{
-    AND(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::AND_ZP_X()
-{
-    AND(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::ROL_ZP_X()
-{
-    ROL(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::AND_ABS_Y()
-{
-    AND(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::AND_ABS_X()
-{
-    AND(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::ROL_ABS_X()
-{
-    ROL(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 7;
-}
-
-u8 Cpu::EOR_IND_X()
-{
-    EOR(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
+template <Mode mode, Cpu::Index index>
+u16 Cpu::Address(bool& pageCrossed)
+{
+    const u8 offset = index == Index::X ? this->registers.X : (index == Index::Y ? this->registers.Y : 0);
+    u16 base;
+    u16 address;
+    switch (mode) {
+    case Mode::ZeroPage:
+        return NesMemory::ZeroPage(OperandByte());
+    case Mode::ZeroPageIndexed:
+        return NesMemory::ZeroPageIndexed(OperandByte(), offset);
+    case Mode::Absolute:
+        return this->operand;
+    case Mode::Indexed:
+        base = this->operand;
+        address = base + offset;
+        pageCrossed = NesMemory::IsPageCrossed(base, address);
+        return address;
+    case Mode::PreIndexedIndirect:
+        return nes.ram.PreIndexedIndirect(OperandByte(), offset);
+    case Mode::PostIndexedIndirect:
+        base = nes.ram.Indirect(OperandByte(), 0);
+        address = base + offset;
+        pageCrossed = NesMemory::IsPageCrossed(base, address);
+        return address;
+    default:
+        return 0;
+    }
 }
 
-u8 Cpu::EOR_ZP()
+template <void (Cpu::*operation)(const u8), Mode mode, Cpu::Index index>
+u8 Cpu::Read()
 {
-    EOR(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
+    if (mode == Mode::Immediate) {
+        (this->*operation)(OperandByte());
+        return ReadCycles(mode);
+    }
+    bool pageCrossed = false;
+    (this->*operation)(nes.ram[Address<mode, index>(pageCrossed)]);
+    return ReadCycles(mode) + pageCrossed;
 }
 
-u8 Cpu::LSR_ZP()
+template <void (Cpu::*operation)(u8&), Mode mode, Cpu::Index index>
+u8 Cpu::Modify()
 {
-    LSR(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 5;
+    if (mode == Mode::Accumulator) {
+        (this->*operation)(this->registers.A);
+        return ModifyCycles(mode);
+    }
+    bool pageCrossed = false;
+    Memory memory = nes.ram[Address<mode, index>(pageCrossed)];
+    u8 value = memory;
+    (this->*operation)(value);
+    memory = value;
+    return ModifyCycles(mode);
 }
 
-u8 Cpu::EOR_IMM()
+template <void (Cpu::*operation)(const Cpu::Memory), Mode mode, Cpu::Index index>
+u8 Cpu::Store()
 {
-    EOR(Operand(1));
-    return 2;
+    bool pageCrossed = false;
+    (this->*operation)(nes.ram[Address<mode, index>(pageCrossed)]);
+    return StoreCycles(mode);
 }
 
-u8 Cpu::LSR_ACC()
-{
-    LSR(this->registers.A);
-    return 2;
-}
+#define CPU_OPCODE(opcode, handler, size)
+#define CPU_OPERATION(opcode, handler, size, kind, operation, mode, index) \
+    u8 Cpu::handler()                                                       \
+    {                                                                       \
+        return kind<&Cpu::operation, Mode::mode, Index::index>();          \
+    }
+#include "cpu_opcodes.h"
+#undef CPU_OPERATION
+#undef CPU_OPCODE
 
 u8 Cpu::JMP_ABS()
 {
-    JMP(nes.ram.Absolute(Operand(1), Operand(2)));
+    JMP(this->operand);
     return 3;
 }
 
-u8 Cpu::EOR_ABS()
-{
-    EOR(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::LSR_ABS()
-{
-    LSR(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 6;
-}
-
-u8 Cpu::EOR_IND_Y()
-{
-    EOR(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::EOR_ZP_X()
-{
-    EOR(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::LSR_ZP_X()
-{
-    LSR(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::EOR_ABS_Y()
-{
-    EOR(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::EOR_ABS_X()
-{
-    EOR(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::LSR_ABS_X()
-{
-    LSR(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 7;
-}
-
-u8 Cpu::ADC_IND_X()
-{
-    ADC(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::ADC_ZP()
-{
-    ADC(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::ROR_ZP()
-{
-    ROR(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 5;
-}
-
-u8 Cpu::ADC_IMM()
-{
-    ADC(Operand(1));
-    return 2;
-}
-
-u8 Cpu::ROR_ACC()
-{
-    ROR(this->registers.A);
-    return 2;
-}
-
 u8 Cpu::JMP_IND()
 {
-    if (NesMemory::IsPageCrossed(this->registers.PC + 1, this->registers.PC + 2))
-        JMP(nes.ram.Indirect(Operand(1), Operand(-0xFE))); //wrap around
-    else
-        JMP(nes.ram.Indirect(Operand(1), Operand(2)));
+    // the pointer high byte is read from the same page (Indirect wraps around)
+    JMP(nes.ram.Indirect(OperandByte(), this->operand >> 8));
     return 5;
 }
 
-u8 Cpu::ADC_ABS()
-{
-    ADC(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::ROR_ABS()
-{
-    ROR(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 6;
-}
-
-u8 Cpu::ADC_IND_Y()
-{
-    ADC(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::ADC_ZP_X()
-{
-    ADC(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::ROR_ZP_X()
-{
-    ROR(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::ADC_ABS_Y()
-{
-    ADC(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::ADC_ABS_X()
-{
-    ADC(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::ROR_ABS_X()
-{
-    ROR(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 7;
-}
-
-u8 Cpu::STA_IND_X()
-{
-    STA(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::STY_ZP()
-{
-    STY(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::STA_ZP()
-{
-    STA(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::STX_ZP()
-{
-    STX(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::STY_ABS()
-{
-    STY(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::STA_ABS()
-{
-    STA(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::STX_ABS()
-{
-    STX(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::STA_IND_Y()
-{
-    STA(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    return 6;
-}
-
-u8 Cpu::STY_ZP_X()
-{
-    STY(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::STA_ZP_X()
-{
-    STA(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::STX_ZP_Y()
-{
-    STX(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.Y));
-    return 4;
-}
-
-u8 Cpu::STA_ABS_Y()
-{
-    STA(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    return 5;
-}
-
-u8 Cpu::STA_ABS_X()
-{
-    STA(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 5;
-}
-
-u8 Cpu::LDY_IMM()
-{
-    LDY(Operand(1));
-    return 2;
-}
-
-u8 Cpu::LDA_IND_X()
-{
-    LDA(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::LDX_IMM()
-{
-    LDX(Operand(1));
-    return 2;
-}
-
-u8 Cpu::LDY_ZP()
-{
-    LDY(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::LDA_ZP()
-{
-    LDA(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::LDX_ZP()
-{
-    LDX(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::LDA_IMM()
-{
-    LDA(Operand(1));
-    return 2;
-}
-
-u8 Cpu::LDY_ABS()
-{
-    LDY(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::LDA_ABS()
-{
-    LDA(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::LDX_ABS()
-{
-    LDX(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::LDA_IND_Y()
-{
-    LDA(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::LDY_ZP_X()
-{
-    LDY(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::LDA_ZP_X()
-{
-    LDA(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::LDX_ZP_Y()
-{
-    LDX(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.Y));
-    return 4;
-}
-
-u8 Cpu::LDA_ABS_Y()
-{
-    LDA(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::LDY_ABS_X()
-{
-    LDY(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::LDA_ABS_X()
-{
-    LDA(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::LDX_ABS_Y()
-{
-    LDX(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::CPY_IMM()
-{
-    CPY(Operand(1));
-    return 2;
-}
-
-u8 Cpu::CMP_IND_X()
-{
-    CMP(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::CPY_ZP()
-{
-    CPY(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::CMP_ZP()
-{
-    CMP(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::DEC_ZP()
-{
-    DEC(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 5;
-}
-
-u8 Cpu::CMP_IMM()
-{
-    CMP(Operand(1));
-    return 2;
-}
-
-u8 Cpu::CPY_ABS()
-{
-    CPY(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::CMP_ABS()
-{
-    CMP(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
-
-u8 Cpu::DEC_ABS()
-{
-    DEC(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 6;
-}
-
-u8 Cpu::CMP_IND_Y()
-{
-    CMP(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::CMP_ZP_X()
-{
-    CMP(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
-
-u8 Cpu::DEC_ZP_X()
-{
-    DEC(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::CMP_ABS_Y()
-{
-    CMP(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
-
-u8 Cpu::CMP_ABS_X()
-{
-    CMP(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
-
-u8 Cpu::DEC_ABS_X()
-{
-    DEC(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 7;
-}
-
-u8 Cpu::CPX_IMM()
-{
-    CPX(Operand(1));
-    return 2;
-}
-
-u8 Cpu::SBC_IND_X()
-{
-    SBC(nes.ram.Get<Mode::PreIndexedIndirect>(Operand(1), this->registers.X));
-    return 6;
-}
-
-u8 Cpu::CPX_ZP()
-{
-    CPX(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::SBC_ZP()
-{
-    SBC(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 3;
-}
-
-u8 Cpu::INC_ZP()
-{
-    INC(nes.ram.Get<Mode::ZeroPage>(Operand(1)));
-    return 5;
-}
+////////////////////////////////////////////////////////////////////////////////
+/// Dispatch
+////////////////////////////////////////////////////////////////////////////////
 
-u8 Cpu::SBC_IMM()
-{
-    SBC(Operand(1));
-    return 2;
-}
+#ifdef CPU_SWITCH_DISPATCH
 
-u8 Cpu::CPX_ABS()
+// Every handler above is defined in this translation unit, so the compiler can
+// inline them into their case and turn the dispatch into a single jump table.
+u8 Cpu::Execute(u8 opcode)
 {
-    CPX(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
+    u8 cycles = 0;
+    switch (opcode) {
+#define CPU_OPCODE(opcode, handler, size) \
+    case opcode:                          \
+        cycles = handler();               \
+        this->registers.PC += size;       \
+        break;
+#include "cpu_opcodes.h"
+#undef CPU_OPCODE
+    }
+    return cycles;
 }
 
-u8 Cpu::SBC_ABS()
-{
-    SBC(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 4;
-}
+#else
 
-u8 Cpu::INC_ABS()
+u8 Cpu::Execute(u8 opcode)
 {
-    INC(nes.ram.Get<Mode::Absolute>(Operand(1), Operand(2)));
-    return 6;
+    const InstructionInfo& instruction = this->instructions[opcode];
+    u8 cycles = (this->*(instruction.fct))();
+    this->registers.PC += instruction.size;
+    return cycles;
 }
 
-u8 Cpu::SBC_IND_Y()
-{
-    SBC(nes.ram.Get<Mode::PostIndexedIndirect>(Operand(1), this->registers.Y));
-    auto address = nes.ram.Indirect(Operand(1), 0);
-    return 5 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
+#endif
 
-u8 Cpu::SBC_ZP_X()
-{
-    SBC(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 4;
-}
+////////////////////////////////////////////////////////////////////////////////
+/// Fused Pairs
+////////////////////////////////////////////////////////////////////////////////
 
-u8 Cpu::INC_ZP_X()
+template <u8 first, u8 second>
+u8 Cpu::Fused(const DecodedInstruction& instruction, const u64 budget)
 {
-    INC(nes.ram.Get<Mode::ZeroPageIndexed>(Operand(1), this->registers.X));
-    return 6;
-}
+    constexpr Instruction firstHandler = Handlers[first];
+    constexpr Instruction secondHandler = Handlers[second];
 
-u8 Cpu::SBC_ABS_Y()
-{
-    SBC(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.Y));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.Y);
-}
+    const u8 firstCycles = (this->*firstHandler)();
+    this->registers.PC += Sizes[first];
 
-u8 Cpu::SBC_ABS_X()
-{
-    SBC(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    auto address = NesMemory::FromValues(Operand(1), Operand(2));
-    return 4 + NesMemory::IsPageCrossed(address, address + this->registers.X);
-}
+    // an event due after the first instruction is delivered before the second
+    if (u64(firstCycles) * 3 >= budget) {
+        this->cycles = firstCycles;
+        return firstCycles;
+    }
 
-u8 Cpu::INC_ABS_X()
-{
-    INC(nes.ram.Get<Mode::Indexed>(Operand(1), Operand(2), this->registers.X));
-    return 7;
+    this->currentOpcode = second;
+    this->operand = instruction.fusedOperand;
+    this->previousPC = this->registers.PC;
+    this->cycles = (this->*secondHandler)();
+    this->registers.PC += Sizes[second];
+    return firstCycles + this->cycles;
+}
+
+u8 Cpu::ExecuteFused(const DecodedInstruction& instruction, const u64 budget)
+{
+    switch (instruction.fusion) {
+#define CPU_OPCODE(opcode, handler, size)
+#define CPU_FUSED(name, first, second) \
+    case Fusion::name:                 \
+        return Fused<first, second>(instruction, budget);
+#include "cpu_opcodes.h"
+#undef CPU_FUSED
+#undef CPU_OPCODE
+    case Fusion::None:
+        break;
+    }
+    this->cycles = Execute(this->currentOpcode);
+    return this->cycles;
 }
@@ -0,0 +1,486 @@
+#include "frame_converter.h"
+#include "dependencies.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NotNative)
+    #define FRAME_CONVERTER_X86
+    #include <immintrin.h>
+#elif defined(__ARM_NEON) && !defined(NotNative)
+    #define FRAME_CONVERTER_NEON
+    #include <arm_neon.h>
+#endif
+
+using namespace Frankenstein;
+
+namespace {
+
+typedef u8 Planes[4][64];
+typedef u8 Colors[64][4];
+
+// BT.601, in 1/256: full range luma, and the video range YUV
+u8 Luma(const Ppu::RGBColor& c)
+{
+    return u8((77 * c.red + 150 * c.green + 29 * c.blue + 128) >> 8);
+}
+
+u8 VideoY(const Ppu::RGBColor& c)
+{
+    return u8(((66 * c.red + 129 * c.green + 25 * c.blue + 128) >> 8) + 16);
+}
+
+u8 VideoU(const Ppu::RGBColor& c)
+{
+    return u8(((-38 * c.red - 74 * c.green + 112 * c.blue + 128) >> 8) + 128);
+}
+
+u8 VideoV(const Ppu::RGBColor& c)
+{
+    return u8(((112 * c.red - 94 * c.green - 18 * c.blue + 128) >> 8) + 128);
+}
+
+u8 Average(const u8 a, const u8 b)
+{
+    return u8((a + b + 1) >> 1);
+}
+
+template <u32 Bytes>
+void PackScalar(const u8* pixels, u8* out, u32 count, const Colors& colors)
+{
+    for (u32 i = 0; i < count; ++i) {
+        memcpy(out + i * Bytes, colors[pixels[i] & 0x3F], Bytes);
+    }
+}
+
+/**
+ * Averages a chroma plane over the 2x2 blocks of the rows top and bottom
+ */
+u8 BlockScalar(const u8* top, const u8* bottom, u32 x, const u8 (&plane)[64])
+{
+    const u8 left = Average(plane[top[x] & 0x3F], plane[bottom[x] & 0x3F]);
+    const u8 right = Average(plane[top[x + 1] & 0x3F], plane[bottom[x + 1] & 0x3F]);
+    return Average(left, right);
+}
+
+void ChromaScalar(const u8* top, const u8* bottom, u8* u, u8* v, u32 width, const Planes& planes)
+{
+    for (u32 x = 0; x + 1 < width; x += 2) {
+        u[x / 2] = BlockScalar(top, bottom, x, planes[1]);
+        v[x / 2] = BlockScalar(top, bottom, x, planes[2]);
+    }
+}
+
+#ifdef FRAME_CONVERTER_X86
+
+/**
+ * pshufb looks up 16 entries, a byte of the 64 colors is one of 4 lookups:
+ * the index minus 16 * k with 0x70 added saturating only keeps bit 7 clear,
+ * selecting a table entry instead of 0, for the indexes of the table k
+ */
+struct Ssse3Table {
+    __m128i parts[4];
+};
+
+__attribute__((target("ssse3")))
+inline Ssse3Table LoadSsse3(const u8 (&plane)[64])
+{
+    Ssse3Table table;
+    for (u32 k = 0; k < 4; ++k) {
+        table.parts[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + k * 16));
+    }
+    return table;
+}
+
+__attribute__((target("ssse3")))
+inline void SelectSsse3(const u8* pixels, __m128i (&select)[4])
+{
+    const __m128i index = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)),
+                                        _mm_set1_epi8(0x3F));
+    for (u32 k = 0; k < 4; ++k) {
+        select[k] = _mm_adds_epu8(_mm_sub_epi8(index, _mm_set1_epi8(char(k * 16))), _mm_set1_epi8(0x70));
+    }
+}
+
+__attribute__((target("ssse3")))
+inline __m128i LookupSsse3(const Ssse3Table& table, const __m128i (&select)[4])
+{
+    return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(table.parts[0], select[0]),
+                                     _mm_shuffle_epi8(table.parts[1], select[1])),
+                        _mm_or_si128(_mm_shuffle_epi8(table.parts[2], select[2]),
+                                     _mm_shuffle_epi8(table.parts[3], select[3])));
+}
+
+template <u32 Bytes>
+__attribute__((target("ssse3")))
+u32 PackSsse3(const u8* pixels, u8* out, u32 count, const Planes& planes)
+{
+    Ssse3Table tables[Bytes];
+    for (u32 b = 0; b < Bytes; ++b) {
+        tables[b] = LoadSsse3(planes[b]);
+    }
+
+    u32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i select[4];
+        SelectSsse3(pixels + i, select);
+        __m128i bytes[4];
+        for (u32 b = 0; b < Bytes; ++b) {
+            bytes[b] = LookupSsse3(tables[b], select);
+        }
+
+        // interleave the bytes of the pixels
+        __m128i* dst = reinterpret_cast<__m128i*>(out + i * Bytes);
+        if (Bytes == 1) {
+            _mm_storeu_si128(dst, bytes[0]);
+        } else if (Bytes == 2) {
+            _mm_storeu_si128(dst + 0, _mm_unpacklo_epi8(bytes[0], bytes[1]));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi8(bytes[0], bytes[1]));
+        } else {
+            const __m128i low01 = _mm_unpacklo_epi8(bytes[0], bytes[1]);
+            const __m128i high01 = _mm_unpackhi_epi8(bytes[0], bytes[1]);
+            const __m128i low23 = _mm_unpacklo_epi8(bytes[2], bytes[3]);
+            const __m128i high23 = _mm_unpackhi_epi8(bytes[2], bytes[3]);
+            _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(low01, low23));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(low01, low23));
+            _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(high01, high23));
+            _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(high01, high23));
+        }
+    }
+    return i;
+}
+
+// averages vertically, then the pairs of columns as 16-bit words
+__attribute__((target("ssse3")))
+inline void BlocksSsse3(const __m128i up, const __m128i down, u8* out)
+{
+    const __m128i columns = _mm_avg_epu8(up, down);
+    const __m128i blocks = _mm_avg_epu16(_mm_and_si128(columns, _mm_set1_epi16(0x00FF)),
+                                         _mm_srli_epi16(columns, 8));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(blocks, blocks));
+}
+
+__attribute__((target("ssse3")))
+u32 ChromaSsse3(const u8* top, const u8* bottom, u8* u, u8* v, u32 width, const Planes& planes)
+{
+    const Ssse3Table uTable = LoadSsse3(planes[1]);
+    const Ssse3Table vTable = LoadSsse3(planes[2]);
+
+    u32 x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i up[4];
+        __m128i down[4];
+        SelectSsse3(top + x, up);
+        SelectSsse3(bottom + x, down);
+        BlocksSsse3(LookupSsse3(uTable, up), LookupSsse3(uTable, down), u + x / 2);
+        BlocksSsse3(LookupSsse3(vTable, up), LookupSsse3(vTable, down), v + x / 2);
+    }
+    return x;
+}
+
+/**
+ * The SSSE3 lookups on 32 pixels, the shuffles and unpacks work within each
+ * 128-bit half
+ */
+struct Avx2Table {
+    __m256i parts[4];
+};
+
+template <u32 Bytes>
+__attribute__((target("avx2")))
+u32 PackAvx2(const u8* pixels, u8* out, u32 count, const Planes& planes)
+{
+    Avx2Table tables[Bytes];
+    for (u32 b = 0; b < Bytes; ++b) {
+        for (u32 k = 0; k < 4; ++k) {
+            tables[b].parts[k] = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[b] + k * 16)));
+        }
+    }
+
+    u32 i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i index = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i)),
+                                               _mm256_set1_epi8(0x3F));
+        __m256i select[4];
+        for (u32 k = 0; k < 4; ++k) {
+            select[k] = _mm256_adds_epu8(_mm256_sub_epi8(index, _mm256_set1_epi8(char(k * 16))),
+                                         _mm256_set1_epi8(0x70));
+        }
+        __m256i bytes[4];
+        for (u32 b = 0; b < Bytes; ++b) {
+            const Avx2Table& table = tables[b];
+            bytes[b] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(table.parts[0], select[0]),
+                                                       _mm256_shuffle_epi8(table.parts[1], select[1])),
+                                       _mm256_or_si256(_mm256_shuffle_epi8(table.parts[2], select[2]),
+                                                       _mm256_shuffle_epi8(table.parts[3], select[3])));
+        }
+
+        __m256i* dst = reinterpret_cast<__m256i*>(out + i * Bytes);
+        if (Bytes == 1) {
+            _mm256_storeu_si256(dst, bytes[0]);
+        } else if (Bytes == 2) {
+            // pixels 0-7 and 16-23, 8-15 and 24-31
+            const __m256i low = _mm256_unpacklo_epi8(bytes[0], bytes[1]);
+            const __m256i high = _mm256_unpackhi_epi8(bytes[0], bytes[1]);
+            _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(low, high, 0x20));
+            _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(low, high, 0x31));
+        } else {
+            // pixels 0-3 and 16-19, 4-7 and 20-23, 8-11 and 24-27, 12-15 and 28-31
+            const __m256i low01 = _mm256_unpacklo_epi8(bytes[0], bytes[1]);
+            const __m256i high01 = _mm256_unpackhi_epi8(bytes[0], bytes[1]);
+            const __m256i low23 = _mm256_unpacklo_epi8(bytes[2], bytes[3]);
+            const __m256i high23 = _mm256_unpackhi_epi8(bytes[2], bytes[3]);
+            const __m256i p0 = _mm256_unpacklo_epi16(low01, low23);
+            const __m256i p4 = _mm256_unpackhi_epi16(low01, low23);
+            const __m256i p8 = _mm256_unpacklo_epi16(high01, high23);
+            const __m256i p12 = _mm256_unpackhi_epi16(high01, high23);
+            _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(p0, p4, 0x20));
+            _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(p8, p12, 0x20));
+            _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(p0, p4, 0x31));
+            _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(p8, p12, 0x31));
+        }
+    }
+    return i;
+}
+
+#endif
+
+#ifdef FRAME_CONVERTER_NEON
+
+#ifdef __aarch64__
+
+// tbl looks up the 64 entries at once
+typedef uint8x16x4_t NeonTable;
+
+inline NeonTable LoadNeon(const u8 (&plane)[64])
+{
+    NeonTable table;
+    for (u32 k = 0; k < 4; ++k) {
+        table.val[k] = vld1q_u8(plane + k * 16);
+    }
+    return table;
+}
+
+inline uint8x16_t LookupNeon(const NeonTable& table, const uint8x16_t index)
+{
+    return vqtbl4q_u8(table, index);
+}
+
+#else
+
+// vtbl looks up 32 entries, the colors from 32 are looked up by vtbx which
+// keeps the first lookup for the out of range indexes
+struct NeonTable {
+    uint8x8x4_t low;
+    uint8x8x4_t high;
+};
+
+inline NeonTable LoadNeon(const u8 (&plane)[64])
+{
+    NeonTable table;
+    for (u32 k = 0; k < 4; ++k) {
+        table.low.val[k] = vld1_u8(plane + k * 8);
+        table.high.val[k] = vld1_u8(plane + 32 + k * 8);
+    }
+    return table;
+}
+
+inline uint8x8_t LookupHalfNeon(const NeonTable& table, const uint8x8_t index)
+{
+    return vtbx4_u8(vtbl4_u8(table.low, index), table.high, vsub_u8(index, vdup_n_u8(32)));
+}
+
+inline uint8x16_t LookupNeon(const NeonTable& table, const uint8x16_t index)
+{
+    return vcombine_u8(LookupHalfNeon(table, vget_low_u8(index)), LookupHalfNeon(table, vget_high_u8(index)));
+}
+
+#endif
+
+inline uint8x16_t IndexNeon(const u8* pixels)
+{
+    return vandq_u8(vld1q_u8(pixels), vdupq_n_u8(0x3F));
+}
+
+/**
+ * The interleaving stores write the bytes of the pixels
+ */
+template <u32 Bytes>
+u32 PackNeon(const u8* pixels, u8* out, u32 count, const Planes& planes)
+{
+    NeonTable tables[4];
+    for (u32 b = 0; b < Bytes; ++b) {
+        tables[b] = LoadNeon(planes[b]);
+    }
+
+    u32 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t index = IndexNeon(pixels + i);
+        u8* dst = out + i * Bytes;
+        if (Bytes == 1) {
+            vst1q_u8(dst, LookupNeon(tables[0], index));
+        } else if (Bytes == 2) {
+            uint8x16x2_t bytes;
+            bytes.val[0] = LookupNeon(tables[0], index);
+            bytes.val[1] = LookupNeon(tables[1], index);
+            vst2q_u8(dst, bytes);
+        } else {
+            uint8x16x4_t bytes;
+            for (u32 b = 0; b < 4; ++b) {
+                bytes.val[b] = LookupNeon(tables[b], index);
+            }
+            vst4q_u8(dst, bytes);
+        }
+    }
+    return i;
+}
+
+// averages vertically, then the pairs of columns with a rounding narrowing shift
+inline uint8x8_t BlocksNeon(const uint8x16_t up, const uint8x16_t down)
+{
+    return vrshrn_n_u16(vpaddlq_u8(vrhaddq_u8(up, down)), 1);
+}
+
+u32 ChromaNeon(const u8* top, const u8* bottom, u8* u, u8* v, u32 width, const Planes& planes)
+{
+    const NeonTable uTable = LoadNeon(planes[1]);
+    const NeonTable vTable = LoadNeon(planes[2]);
+
+    u32 x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint8x16_t up = IndexNeon(top + x);
+        const uint8x16_t down = IndexNeon(bottom + x);
+        vst1_u8(u + x / 2, BlocksNeon(LookupNeon(uTable, up), LookupNeon(uTable, down)));
+        vst1_u8(v + x / 2, BlocksNeon(LookupNeon(vTable, up), LookupNeon(vTable, down)));
+    }
+    return x;
+}
+
+#endif
+
+template <u32 Bytes>
+void Pack(const u8* pixels, u8* out, u32 count, const Planes& planes, const Colors& colors)
+{
+    u32 packed = 0;
+#if defined(FRAME_CONVERTER_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        packed = PackAvx2<Bytes>(pixels, out, count, planes);
+    } else if (__builtin_cpu_supports("ssse3")) {
+        packed = PackSsse3<Bytes>(pixels, out, count, planes);
+    }
+#elif defined(FRAME_CONVERTER_NEON)
+    packed = PackNeon<Bytes>(pixels, out, count, planes);
+#endif
+    PackScalar<Bytes>(pixels + packed, out + packed * Bytes, count - packed, colors);
+}
+
+void Chroma(const u8* top, const u8* bottom, u8* u, u8* v, u32 width, const Planes& planes)
+{
+    u32 averaged = 0;
+#if defined(FRAME_CONVERTER_X86)
+    if (__builtin_cpu_supports("ssse3")) {
+        averaged = ChromaSsse3(top, bottom, u, v, width, planes);
+    }
+#elif defined(FRAME_CONVERTER_NEON)
+    averaged = ChromaNeon(top, bottom, u, v, width, planes);
+#endif
+    ChromaScalar(top + averaged, bottom + averaged, u + averaged / 2, v + averaged / 2, width - averaged, planes);
+}
+
+}
+
+FrameConverter::FrameConverter(PixelFormat pFormat)
+    : format(pFormat)
+    , planes()
+    , colors()
+{
+    for (u32 i = 0; i < 64; ++i) {
+        const Ppu::RGBColor& c = Ppu::systemPalette[i];
+        switch (format) {
+        case PixelFormat::RGBA8888:
+            planes[0][i] = c.red;
+            planes[1][i] = c.green;
+            planes[2][i] = c.blue;
+            planes[3][i] = 0xFF;
+            break;
+        case PixelFormat::XRGB8888:
+            planes[0][i] = c.blue;
+            planes[1][i] = c.green;
+            planes[2][i] = c.red;
+            planes[3][i] = 0xFF;
+            break;
+        case PixelFormat::RGB565: {
+            const u16 word = u16((c.red >> 3) << 11 | (c.green >> 2) << 5 | c.blue >> 3);
+            planes[0][i] = u8(word & 0xFF);
+            planes[1][i] = u8(word >> 8);
+            break;
+        }
+        case PixelFormat::Gray8:
+            planes[0][i] = Luma(c);
+            break;
+        case PixelFormat::YUV420:
+            planes[0][i] = VideoY(c);
+            planes[1][i] = VideoU(c);
+            planes[2][i] = VideoV(c);
+            break;
+        default:
+            break;
+        }
+        for (u32 b = 0; b < 4; ++b) {
+            colors[i][b] = planes[b][i];
+        }
+    }
+}
+
+u32 FrameConverter::BytesPerPixel(PixelFormat pixelFormat)
+{
+    switch (pixelFormat) {
+    case PixelFormat::RGBA8888:
+    case PixelFormat::XRGB8888:
+        return 4;
+    case PixelFormat::RGB565:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+u32 FrameConverter::FrameBytes() const
+{
+    if (format == PixelFormat::YUV420) {
+        return Ppu::FramePixels * 3 / 2;
+    }
+    return Ppu::FramePixels * BytesPerPixel(format);
+}
+
+void FrameConverter::ConvertPixels(const u8* pixels, void* out, u32 count) const
+{
+    u8* bytes = static_cast<u8*>(out);
+    switch (BytesPerPixel(format)) {
+    case 4:
+        Pack<4>(pixels, bytes, count, planes, colors);
+        break;
+    case 2:
+        Pack<2>(pixels, bytes, count, planes, colors);
+        break;
+    default:
+        Pack<1>(pixels, bytes, count, planes, colors);
+        break;
+    }
+}
+
+void FrameConverter::Convert(const u8* frame, void* out) const
+{
+    ConvertPixels(frame, out, Ppu::FramePixels);
+    if (format != PixelFormat::YUV420) {
+        return;
+    }
+
+    // the Y plane is the luma of each pixel, the chroma planes follow it
+    const u32 width = Ppu::FrameWidth;
+    u8* u = static_cast<u8*>(out) + Ppu::FramePixels;
+    u8* v = u + Ppu::FramePixels / 4;
+    for (u32 y = 0; y < Ppu::FrameHeight; y += 2) {
+        const u8* top = frame + y * width;
+        const u32 row = y / 2 * width / 2;
+        Chroma(top, top + width, u + row, v + row, width, planes);
+    }
+}
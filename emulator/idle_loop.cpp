@@ -0,0 +1,180 @@
+#include "idle_loop.h"
+#include "nes.h"
+
+using namespace Frankenstein;
+
+namespace {
+
+enum class Kind {
+    Read,
+    Modify,
+    Store
+};
+
+/**
+ * The addressing mode of the instructions only reading their operand
+ * @return false for the other instructions
+ */
+static bool ReadMode(const u8 opcode, Addressing& readMode)
+{
+    switch (opcode) {
+#define CPU_OPCODE(opcode, handler, size)
+#define CPU_OPERATION(opcode, handler, size, kind, operation, mode, index) \
+    case opcode:                                                            \
+        readMode = Addressing::mode;                                        \
+        return Kind::kind == Kind::Read && Cpu::Index::index == Cpu::Index::None;
+#include "cpu_opcodes.h"
+#undef CPU_OPERATION
+#undef CPU_OPCODE
+    }
+    return false;
+}
+
+}
+
+IdleLoop::IdleLoop(Nes& pNes)
+    : enabled(true)
+    , skippedCycles(0)
+    , nes(pNes)
+    , lastPC(0)
+    , page(nullptr)
+    , head(0)
+    , tail(0)
+    , visited(false)
+{
+}
+
+bool IdleLoop::Skip()
+{
+    const u16 pc = nes.cpu.registers.PC;
+    const u16 previous = lastPC;
+    lastPC = pc;
+    if (!enabled) {
+        return false;
+    }
+
+    if (page == nullptr || !InLoop(pc) || !InLoop(previous)) {
+        // entering or leaving the loop, a jump back may start a new one
+        visited = false;
+        if (pc > previous || previous - pc > MaxInstructions * 3 || !Analyse(pc)) {
+            return false;
+        }
+    }
+    if (pc != head) {
+        return false;
+    }
+
+    Cpu& cpu = nes.cpu;
+    const bool same = visited && nes.clock - headClock == iterationDots && cpu.GetStatus() == status &&
+        cpu.registers.A == registers.A && cpu.registers.X == registers.X &&
+        cpu.registers.Y == registers.Y && cpu.registers.SP == registers.SP;
+    if (!same || (readsStatus && !statusKnown)) {
+        Visit();
+        return false;
+    }
+
+    // the previous iteration left the state unchanged, the next ones do too
+    // as long as they read the same values
+    u64 skipped = 0;
+    if (!readsStatus) {
+        if (nes.clock + iterationDots < nes.deadline) {
+            skipped = (nes.deadline - nes.clock - 1) / iterationDots * iterationDots;
+        }
+    } else {
+        while (nes.clock + skipped + iterationDots < nes.deadline) {
+            nes.SyncPpu(nes.clock + skipped + statusDots);
+            if (nes.ppu.peekStatus() != statusValue) {
+                break;
+            }
+            skipped += iterationDots;
+        }
+    }
+
+    nes.clock += skipped;
+    headClock = nes.clock;
+    skippedCycles += skipped / 3;
+    return skipped != 0;
+}
+
+void IdleLoop::Visit()
+{
+    visited = true;
+    registers = nes.cpu.registers;
+    status = nes.cpu.GetStatus();
+    headClock = nes.clock;
+
+    // the iteration syncs the PPU when reading $2002, doing it now tells the
+    // value read as long as no PPU event happens before the iteration ends
+    statusKnown = readsStatus && nes.clock + iterationDots < nes.deadline;
+    if (statusKnown) {
+        nes.SyncPpu(nes.clock + statusDots);
+        statusValue = nes.ppu.peekStatus();
+    }
+}
+
+bool IdleLoop::Analyse(const u16 pc)
+{
+    page = nullptr;
+    auto& bus = nes.ram.bus;
+    const u8* code = bus.ReadPage(pc);
+    if (code == nullptr || bus.WritePage(pc) != nullptr) {
+        return false;
+    }
+
+    readsStatus = false;
+    u32 cycles = 0;
+    u16 address = pc;
+    for (u8 i = 0; i < MaxInstructions; ++i) {
+        const u8 offset = address & 0xFF;
+        if (offset > 0xFD || (address >> 8) != (pc >> 8)) {
+            return false;
+        }
+        const u8 opcode = code[offset];
+        const u16 operand = NesMemory::FromValues(code[offset + 1], code[offset + 2]);
+
+        // JMP abs or a branch back to pc ends the loop
+        if (opcode == 0x4C || (opcode & 0x1F) == 0x10) {
+            u16 target;
+            if (opcode == 0x4C) {
+                target = operand;
+                cycles += 3;
+            } else {
+                const s8 branch = static_cast<s8>(operand & 0xFF);
+                target = address + 2 + branch;
+                cycles += 3 + NesMemory::IsPageCrossed(address + 2, address + branch);
+            }
+            if (target != pc) {
+                return false;
+            }
+            head = pc;
+            tail = address;
+            iterationDots = cycles * 3;
+            page = code;
+            return true;
+        }
+
+        Addressing mode;
+        if (opcode == 0xEA) { // NOP
+            cycles += 2;
+        } else if (ReadMode(opcode, mode)) {
+            if (mode == Addressing::ZeroPage || mode == Addressing::Absolute) {
+                const u16 read = mode == Addressing::ZeroPage ? operand & 0xFF : operand;
+                if (bus.ReadPage(read) == nullptr) {
+                    // I/O: only the PPU status, once
+                    if ((read & 0xE007) != 0x2002 || readsStatus) {
+                        return false;
+                    }
+                    readsStatus = true;
+                    statusDots = cycles * 3;
+                }
+            } else if (mode != Addressing::Immediate) {
+                return false;
+            }
+            cycles += Cpu::ReadCycles(mode);
+        } else {
+            return false;
+        }
+        address += nes.cpu.instructions[opcode].size;
+    }
+    return false;
+}
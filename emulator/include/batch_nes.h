@@ -0,0 +1,55 @@
+#pragma once
+
+#include "nes.h"
+
+namespace Frankenstein {
+
+/**
+ * Many consoles running the same cartridge, stepped a frame at a time.
+ *
+ * Each console (lane) keeps its own state and inputs. The ROM, its mapped
+ * PRG and CHR banks and the decoded PRG ROM instructions are shared: a block
+ * decoded by one lane is a hit for the others when they run the same code.
+ * The lanes run on the scalar core one after the other, there is no lockstep
+ * or SIMD execution across lanes.
+ */
+class BatchNes {
+public:
+    BatchNes(Rom& rom, u32 lanes);
+    ~BatchNes();
+
+    // owns the consoles
+    BatchNes(const BatchNes&) = delete;
+    BatchNes& operator=(const BatchNes&) = delete;
+
+    u32 Lanes() const
+    {
+        return count;
+    }
+
+    /**
+     * The console of a lane, to observe its RAM, CPU or frame buffers
+     * between steps
+     */
+    Nes& Lane(u32 lane)
+    {
+        return *consoles[lane];
+    }
+
+    /**
+     * Sets the buttons held on the first gamepad of a lane, bit n is the
+     * Gamepad::ButtonIndex n. Read by the game from the next StepAll.
+     */
+    void SetButtons(u32 lane, u8 buttons);
+
+    /**
+     * Runs one frame on every lane, one lane after the other
+     */
+    void StepAll();
+
+private:
+    u32 count;
+    Nes** consoles;
+};
+
+}
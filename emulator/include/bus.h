@@ -1,29 +1,154 @@
 #pragma once
 
+#include "util.h"
+
 namespace Frankenstein {
 
-template <typename AddressingType>
+/**
+ * Devices driving the IRQ line, one bit each
+ */
+enum IRQSource : u8 {
+    IRQMapper = 0x01
+};
+
+/**
+ * Receives the IRQ line. A device holds it asserted until the program
+ * acknowledges the interrupt through the device registers.
+ */
 class IIRQListener
 {
 public:
-    virtual void processIRQ() = 0;
+    virtual void processIRQ(const u8 source, const bool asserted) = 0;
 };
 
-template <typename AddressingType>
+/**
+ * Handles the accesses to a page of memory mapped registers
+ */
+template <typename DataType, typename AddressingType>
 class IMemoryListener
 {
 public:
-    virtual void read() = 0;
-    virtual void write() = 0;
+    virtual DataType Read(const AddressingType address) = 0;
+    virtual void Write(const AddressingType address, const DataType value) = 0;
 };
 
-template <typename AddressingType>
+/**
+ * Page table of an address space.
+ *
+ * A page either points to host memory (RAM, ROM), accessed with a single
+ * indexed load or store, or is handled by a listener (I/O registers, mappers).
+ * Reads and writes are mapped separately so ROM pages can be read directly
+ * while their writes still reach the mapper.
+ */
+template <typename DataType, typename AddressingType, unsigned int PageBits = 8>
 class Bus {
 public:
-    void register(IIRQListener listener);
-    void register(IMemoryListener listener, AddressingType address);
-};
+    using Listener = IMemoryListener<DataType, AddressingType>;
 
-}
+    static constexpr unsigned int PageSize = 1u << PageBits;
+    static constexpr unsigned int PageCount = (1u << (sizeof(AddressingType) * 8)) >> PageBits;
+
+    Bus()
+        : readPages{ nullptr }
+        , writePages{ nullptr }
+        , listeners{ nullptr }
+    {
+    }
+
+    DataType Read(const AddressingType address)
+    {
+        const DataType* page = readPages[address >> PageBits];
+        if (page != nullptr) {
+            return page[address & (PageSize - 1)];
+        }
+        return listeners[address >> PageBits]->Read(address);
+    }
+
+    void Write(const AddressingType address, const DataType value)
+    {
+        DataType* page = writePages[address >> PageBits];
+        if (page != nullptr) {
+            page[address & (PageSize - 1)] = value;
+            return;
+        }
+        listeners[address >> PageBits]->Write(address, value);
+    }
+
+    /**
+     * Host memory backing the page of address for reads, nullptr for I/O pages
+     */
+    const DataType* ReadPage(const AddressingType address) const
+    {
+        return readPages[address >> PageBits];
+    }
 
+    /**
+     * Host memory backing the page of address for writes, nullptr for I/O pages
+     */
+    DataType* WritePage(const AddressingType address) const
+    {
+        return writePages[address >> PageBits];
+    }
 
+    /**
+     * The read page table, one entry per page
+     */
+    const DataType* const* ReadPages() const
+    {
+        return readPages;
+    }
+
+    /**
+     * The write page table, one entry per page
+     */
+    DataType* const* WritePages() const
+    {
+        return writePages;
+    }
+
+    /**
+     * Hands the pages of [first, last] to a listener for both reads and writes.
+     * first and last + 1 must be page aligned.
+     */
+    void Register(Listener* listener, const AddressingType first, const AddressingType last)
+    {
+        for (u32 page = first >> PageBits; page <= (u32(last) >> PageBits); ++page) {
+            readPages[page] = nullptr;
+            writePages[page] = nullptr;
+            listeners[page] = listener;
+        }
+    }
+
+    /**
+     * Maps host memory for reads and writes over [first, last], mirrored
+     * every size bytes.
+     */
+    void Map(DataType* memory, const u32 size, const AddressingType first, const AddressingType last)
+    {
+        for (u32 page = first >> PageBits; page <= (u32(last) >> PageBits); ++page) {
+            u32 offset = ((page << PageBits) - first) % size;
+            readPages[page] = memory + offset;
+            writePages[page] = memory + offset;
+        }
+    }
+
+    /**
+     * Maps host memory for reads only over [first, last], mirrored every size
+     * bytes. Writes still go to the listener of the pages.
+     */
+    void MapRead(const DataType* memory, const u32 size, const AddressingType first, const AddressingType last)
+    {
+        for (u32 page = first >> PageBits; page <= (u32(last) >> PageBits); ++page) {
+            u32 offset = ((page << PageBits) - first) % size;
+            readPages[page] = memory + offset;
+            writePages[page] = nullptr;
+        }
+    }
+
+private:
+    const DataType* readPages[PageCount];
+    DataType* writePages[PageCount];
+    Listener* listeners[PageCount];
+};
+
+}
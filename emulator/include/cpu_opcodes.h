@@ -0,0 +1,293 @@
+//
+// 6502 opcode table, indexed by opcode.
+//
+// Each entry is CPU_OPCODE(opcode, handler, size) where size is the number of
+// bytes added to PC once the handler returns (0 when the handler sets PC itself).
+// Define CPU_OPCODE before including this file.
+//
+// The handlers built from an (operation x addressing mode) pair are listed as
+// CPU_OPERATION(opcode, handler, size, kind, operation, mode, index): kind is
+// the Cpu::Read, Cpu::Modify or Cpu::Store template, operation the Cpu member
+// applied to the operand, mode its Addressing and index the index register.
+// They expand to CPU_OPCODE unless CPU_OPERATION is defined too.
+//
+// The pairs of instructions the CPU executes with a single handler when the
+// second one follows the first in a decoded block are listed at the end as
+// CPU_FUSED(name, first, second), with the opcodes of the two instructions.
+// They are only expanded when CPU_FUSED is defined.
+//
+
+#ifndef CPU_OPERATION
+#define CPU_OPERATION(opcode, handler, size, kind, operation, mode, index) CPU_OPCODE(opcode, handler, size)
+#define CPU_OPERATION_AS_OPCODE
+#endif
+
+CPU_OPCODE(0x00, BRK,       0)
+CPU_OPERATION(0x01, ORA_IND_X, 2, Read,   ORA, PreIndexedIndirect,  X)
+CPU_OPCODE(0x02, UNIMP,     1)
+CPU_OPCODE(0x03, UNIMP,     1)
+CPU_OPCODE(0x04, UNIMP,     1)
+CPU_OPERATION(0x05, ORA_ZP,    2, Read,   ORA, ZeroPage,            None)
+CPU_OPERATION(0x06, ASL_ZP,    2, Modify, ASL, ZeroPage,            None)
+CPU_OPCODE(0x07, UNIMP,     1)
+CPU_OPCODE(0x08, PHP,       1)
+CPU_OPERATION(0x09, ORA_IMM,   2, Read,   ORA, Immediate,           None)
+CPU_OPERATION(0x0A, ASL_ACC,   1, Modify, ASL, Accumulator,         None)
+CPU_OPCODE(0x0B, UNIMP,     1)
+CPU_OPCODE(0x0C, UNIMP,     1)
+CPU_OPERATION(0x0D, ORA_ABS,   3, Read,   ORA, Absolute,            None)
+CPU_OPERATION(0x0E, ASL_ABS,   3, Modify, ASL, Absolute,            None)
+CPU_OPCODE(0x0F, UNIMP,     1)
+CPU_OPCODE(0x10, BPL,       2)
+CPU_OPERATION(0x11, ORA_IND_Y, 2, Read,   ORA, PostIndexedIndirect, Y)
+CPU_OPCODE(0x12, UNIMP,     1)
+CPU_OPCODE(0x13, UNIMP,     1)
+CPU_OPCODE(0x14, UNIMP,     1)
+CPU_OPERATION(0x15, ORA_ZP_X,  2, Read,   ORA, ZeroPageIndexed,     X)
+CPU_OPERATION(0x16, ASL_ZP_X,  2, Modify, ASL, ZeroPageIndexed,     X)
+CPU_OPCODE(0x17, UNIMP,     1)
+CPU_OPCODE(0x18, CLC,       1)
+CPU_OPERATION(0x19, ORA_ABS_Y, 3, Read,   ORA, Indexed,             Y)
+CPU_OPCODE(0x1A, NOP,       1)
+CPU_OPCODE(0x1B, UNIMP,     1)
+CPU_OPCODE(0x1C, UNIMP,     1)
+CPU_OPERATION(0x1D, ORA_ABS_X, 3, Read,   ORA, Indexed,             X)
+CPU_OPERATION(0x1E, ASL_ABS_X, 3, Modify, ASL, Indexed,             X)
+CPU_OPCODE(0x1F, UNIMP,     1)
+CPU_OPCODE(0x20, JSR,       0)
+CPU_OPERATION(0x21, AND_IND_X, 2, Read,   AND, PreIndexedIndirect,  X)
+CPU_OPCODE(0x22, UNIMP,     1)
+CPU_OPCODE(0x23, UNIMP,     1)
+CPU_OPERATION(0x24, BIT_ZP,    2, Read,   BIT, ZeroPage,            None)
+CPU_OPERATION(0x25, AND_ZP,    2, Read,   AND, ZeroPage,            None)
+CPU_OPERATION(0x26, ROL_ZP,    2, Modify, ROL, ZeroPage,            None)
+CPU_OPCODE(0x27, UNIMP,     1)
+CPU_OPCODE(0x28, PLP,       1)
+CPU_OPERATION(0x29, AND_IMM,   2, Read,   AND, Immediate,           None)
+CPU_OPERATION(0x2A, ROL_ACC,   1, Modify, ROL, Accumulator,         None)
+CPU_OPCODE(0x2B, UNIMP,     1)
+CPU_OPERATION(0x2C, BIT_ABS,   3, Read,   BIT, Absolute,            None)
+CPU_OPERATION(0x2D, AND_ABS,   3, Read,   AND, Absolute,            None)
+CPU_OPERATION(0x2E, ROL_ABS,   3, Modify, ROL, Absolute,            None)
+CPU_OPCODE(0x2F, UNIMP,     1)
+CPU_OPCODE(0x30, BMI,       2)
+CPU_OPERATION(0x31, AND_IND_Y, 2, Read,   AND, PostIndexedIndirect, Y)
+CPU_OPCODE(0x32, UNIMP,     1)
+CPU_OPCODE(0x33, UNIMP,     1)
+CPU_OPCODE(0x34, UNIMP,     1)
+CPU_OPERATION(0x35, AND_ZP_X,  2, Read,   AND, ZeroPageIndexed,     X)
+CPU_OPERATION(0x36, ROL_ZP_X,  2, Modify, ROL, ZeroPageIndexed,     X)
+CPU_OPCODE(0x37, UNIMP,     1)
+CPU_OPCODE(0x38, SEC,       1)
+CPU_OPERATION(0x39, AND_ABS_Y, 3, Read,   AND, Indexed,             Y)
+CPU_OPCODE(0x3A, NOP,       1)
+CPU_OPCODE(0x3B, UNIMP,     1)
+CPU_OPCODE(0x3C, UNIMP,     1)
+CPU_OPERATION(0x3D, AND_ABS_X, 3, Read,   AND, Indexed,             X)
+CPU_OPERATION(0x3E, ROL_ABS_X, 3, Modify, ROL, Indexed,             X)
+CPU_OPCODE(0x3F, UNIMP,     1)
+CPU_OPCODE(0x40, RTI,       0)
+CPU_OPERATION(0x41, EOR_IND_X, 2, Read,   EOR, PreIndexedIndirect,  X)
+CPU_OPCODE(0x42, UNIMP,     1)
+CPU_OPCODE(0x43, UNIMP,     1)
+CPU_OPCODE(0x44, UNIMP,     1)
+CPU_OPERATION(0x45, EOR_ZP,    2, Read,   EOR, ZeroPage,            None)
+CPU_OPERATION(0x46, LSR_ZP,    2, Modify, LSR, ZeroPage,            None)
+CPU_OPCODE(0x47, UNIMP,     1)
+CPU_OPCODE(0x48, PHA,       1)
+CPU_OPERATION(0x49, EOR_IMM,   2, Read,   EOR, Immediate,           None)
+CPU_OPERATION(0x4A, LSR_ACC,   1, Modify, LSR, Accumulator,         None)
+CPU_OPCODE(0x4B, UNIMP,     1)
+CPU_OPCODE(0x4C, JMP_ABS,   0)
+CPU_OPERATION(0x4D, EOR_ABS,   3, Read,   EOR, Absolute,            None)
+CPU_OPERATION(0x4E, LSR_ABS,   3, Modify, LSR, Absolute,            None)
+CPU_OPCODE(0x4F, UNIMP,     1)
+CPU_OPCODE(0x50, BVC,       2)
+CPU_OPERATION(0x51, EOR_IND_Y, 2, Read,   EOR, PostIndexedIndirect, Y)
+CPU_OPCODE(0x52, UNIMP,     1)
+CPU_OPCODE(0x53, UNIMP,     1)
+CPU_OPCODE(0x54, UNIMP,     1)
+CPU_OPERATION(0x55, EOR_ZP_X,  2, Read,   EOR, ZeroPageIndexed,     X)
+CPU_OPERATION(0x56, LSR_ZP_X,  2, Modify, LSR, ZeroPageIndexed,     X)
+CPU_OPCODE(0x57, UNIMP,     1)
+CPU_OPCODE(0x58, CLI,       1)
+CPU_OPERATION(0x59, EOR_ABS_Y, 3, Read,   EOR, Indexed,             Y)
+CPU_OPCODE(0x5A, NOP,       1)
+CPU_OPCODE(0x5B, UNIMP,     1)
+CPU_OPCODE(0x5C, UNIMP,     1)
+CPU_OPERATION(0x5D, EOR_ABS_X, 3, Read,   EOR, Indexed,             X)
+CPU_OPERATION(0x5E, LSR_ABS_X, 3, Modify, LSR, Indexed,             X)
+CPU_OPCODE(0x5F, UNIMP,     1)
+CPU_OPCODE(0x60, RTS,       1)
+CPU_OPERATION(0x61, ADC_IND_X, 2, Read,   ADC, PreIndexedIndirect,  X)
+CPU_OPCODE(0x62, UNIMP,     1)
+CPU_OPCODE(0x63, UNIMP,     1)
+CPU_OPCODE(0x64, UNIMP,     1)
+CPU_OPERATION(0x65, ADC_ZP,    2, Read,   ADC, ZeroPage,            None)
+CPU_OPERATION(0x66, ROR_ZP,    2, Modify, ROR, ZeroPage,            None)
+CPU_OPCODE(0x67, UNIMP,     1)
+CPU_OPCODE(0x68, PLA,       1)
+CPU_OPERATION(0x69, ADC_IMM,   2, Read,   ADC, Immediate,           None)
+CPU_OPERATION(0x6A, ROR_ACC,   1, Modify, ROR, Accumulator,         None)
+CPU_OPCODE(0x6B, UNIMP,     1)
+CPU_OPCODE(0x6C, JMP_IND,   0)
+CPU_OPERATION(0x6D, ADC_ABS,   3, Read,   ADC, Absolute,            None)
+CPU_OPERATION(0x6E, ROR_ABS,   3, Modify, ROR, Absolute,            None)
+CPU_OPCODE(0x6F, UNIMP,     1)
+CPU_OPCODE(0x70, BVS,       2)
+CPU_OPERATION(0x71, ADC_IND_Y, 2, Read,   ADC, PostIndexedIndirect, Y)
+CPU_OPCODE(0x72, UNIMP,     1)
+CPU_OPCODE(0x73, UNIMP,     1)
+CPU_OPCODE(0x74, UNIMP,     1)
+CPU_OPERATION(0x75, ADC_ZP_X,  2, Read,   ADC, ZeroPageIndexed,     X)
+CPU_OPERATION(0x76, ROR_ZP_X,  2, Modify, ROR, ZeroPageIndexed,     X)
+CPU_OPCODE(0x77, UNIMP,     1)
+CPU_OPCODE(0x78, SEI,       1)
+CPU_OPERATION(0x79, ADC_ABS_Y, 3, Read,   ADC, Indexed,             Y)
+CPU_OPCODE(0x7A, NOP,       1)
+CPU_OPCODE(0x7B, UNIMP,     1)
+CPU_OPCODE(0x7C, UNIMP,     1)
+CPU_OPERATION(0x7D, ADC_ABS_X, 3, Read,   ADC, Indexed,             X)
+CPU_OPERATION(0x7E, ROR_ABS_X, 3, Modify, ROR, Indexed,             X)
+CPU_OPCODE(0x7F, UNIMP,     1)
+CPU_OPCODE(0x80, UNIMP,     1)
+CPU_OPERATION(0x81, STA_IND_X, 2, Store,  STA, PreIndexedIndirect,  X)
+CPU_OPCODE(0x82, UNIMP,     1)
+CPU_OPCODE(0x83, UNIMP,     1)
+CPU_OPERATION(0x84, STY_ZP,    2, Store,  STY, ZeroPage,            None)
+CPU_OPERATION(0x85, STA_ZP,    2, Store,  STA, ZeroPage,            None)
+CPU_OPERATION(0x86, STX_ZP,    2, Store,  STX, ZeroPage,            None)
+CPU_OPCODE(0x87, UNIMP,     1)
+CPU_OPCODE(0x88, DEY,       1)
+CPU_OPCODE(0x89, UNIMP,     1)
+CPU_OPCODE(0x8A, TXA,       1)
+CPU_OPCODE(0x8B, UNIMP,     1)
+CPU_OPERATION(0x8C, STY_ABS,   3, Store,  STY, Absolute,            None)
+CPU_OPERATION(0x8D, STA_ABS,   3, Store,  STA, Absolute,            None)
+CPU_OPERATION(0x8E, STX_ABS,   3, Store,  STX, Absolute,            None)
+CPU_OPCODE(0x8F, UNIMP,     1)
+CPU_OPCODE(0x90, BCC,       2)
+CPU_OPERATION(0x91, STA_IND_Y, 2, Store,  STA, PostIndexedIndirect, Y)
+CPU_OPCODE(0x92, UNIMP,     1)
+CPU_OPCODE(0x93, UNIMP,     1)
+CPU_OPERATION(0x94, STY_ZP_X,  2, Store,  STY, ZeroPageIndexed,     X)
+CPU_OPERATION(0x95, STA_ZP_X,  2, Store,  STA, ZeroPageIndexed,     X)
+CPU_OPERATION(0x96, STX_ZP_Y,  2, Store,  STX, ZeroPageIndexed,     Y)
+CPU_OPCODE(0x97, UNIMP,     1)
+CPU_OPCODE(0x98, TYA,       1)
+CPU_OPERATION(0x99, STA_ABS_Y, 3, Store,  STA, Indexed,             Y)
+CPU_OPCODE(0x9A, TXS,       1)
+CPU_OPCODE(0x9B, UNIMP,     1)
+CPU_OPCODE(0x9C, UNIMP,     1)
+CPU_OPERATION(0x9D, STA_ABS_X, 3, Store,  STA, Indexed,             X)
+CPU_OPCODE(0x9E, UNIMP,     1)
+CPU_OPCODE(0x9F, UNIMP,     1)
+CPU_OPERATION(0xA0, LDY_IMM,   2, Read,   LDY, Immediate,           None)
+CPU_OPERATION(0xA1, LDA_IND_X, 2, Read,   LDA, PreIndexedIndirect,  X)
+CPU_OPERATION(0xA2, LDX_IMM,   2, Read,   LDX, Immediate,           None)
+CPU_OPCODE(0xA3, UNIMP,     1)
+CPU_OPERATION(0xA4, LDY_ZP,    2, Read,   LDY, ZeroPage,            None)
+CPU_OPERATION(0xA5, LDA_ZP,    2, Read,   LDA, ZeroPage,            None)
+CPU_OPERATION(0xA6, LDX_ZP,    2, Read,   LDX, ZeroPage,            None)
+CPU_OPCODE(0xA7, UNIMP,     1)
+CPU_OPCODE(0xA8, TAY,       1)
+CPU_OPERATION(0xA9, LDA_IMM,   2, Read,   LDA, Immediate,           None)
+CPU_OPCODE(0xAA, TAX,       1)
+CPU_OPCODE(0xAB, UNIMP,     1)
+CPU_OPERATION(0xAC, LDY_ABS,   3, Read,   LDY, Absolute,            None)
+CPU_OPERATION(0xAD, LDA_ABS,   3, Read,   LDA, Absolute,            None)
+CPU_OPERATION(0xAE, LDX_ABS,   3, Read,   LDX, Absolute,            None)
+CPU_OPCODE(0xAF, UNIMP,     1)
+CPU_OPCODE(0xB0, BCS,       2)
+CPU_OPERATION(0xB1, LDA_IND_Y, 2, Read,   LDA, PostIndexedIndirect, Y)
+CPU_OPCODE(0xB2, UNIMP,     1)
+CPU_OPCODE(0xB3, UNIMP,     1)
+CPU_OPERATION(0xB4, LDY_ZP_X,  2, Read,   LDY, ZeroPageIndexed,     X)
+CPU_OPERATION(0xB5, LDA_ZP_X,  2, Read,   LDA, ZeroPageIndexed,     X)
+CPU_OPERATION(0xB6, LDX_ZP_Y,  2, Read,   LDX, ZeroPageIndexed,     Y)
+CPU_OPCODE(0xB7, UNIMP,     1)
+CPU_OPCODE(0xB8, CLV,       1)
+CPU_OPERATION(0xB9, LDA_ABS_Y, 3, Read,   LDA, Indexed,             Y)
+CPU_OPCODE(0xBA, TSX,       1)
+CPU_OPCODE(0xBB, UNIMP,     1)
+CPU_OPERATION(0xBC, LDY_ABS_X, 3, Read,   LDY, Indexed,             X)
+CPU_OPERATION(0xBD, LDA_ABS_X, 3, Read,   LDA, Indexed,             X)
+CPU_OPERATION(0xBE, LDX_ABS_Y, 3, Read,   LDX, Indexed,             Y)
+CPU_OPCODE(0xBF, UNIMP,     1)
+CPU_OPERATION(0xC0, CPY_IMM,   2, Read,   CPY, Immediate,           None)
+CPU_OPERATION(0xC1, CMP_IND_X, 2, Read,   CMP, PreIndexedIndirect,  X)
+CPU_OPCODE(0xC2, UNIMP,     1)
+CPU_OPCODE(0xC3, UNIMP,     1)
+CPU_OPERATION(0xC4, CPY_ZP,    2, Read,   CPY, ZeroPage,            None)
+CPU_OPERATION(0xC5, CMP_ZP,    2, Read,   CMP, ZeroPage,            None)
+CPU_OPERATION(0xC6, DEC_ZP,    2, Modify, DEC, ZeroPage,            None)
+CPU_OPCODE(0xC7, UNIMP,     1)
+CPU_OPCODE(0xC8, INY,       1)
+CPU_OPERATION(0xC9, CMP_IMM,   2, Read,   CMP, Immediate,           None)
+CPU_OPCODE(0xCA, DEX,       1)
+CPU_OPCODE(0xCB, UNIMP,     1)
+CPU_OPERATION(0xCC, CPY_ABS,   3, Read,   CPY, Absolute,            None)
+CPU_OPERATION(0xCD, CMP_ABS,   3, Read,   CMP, Absolute,            None)
+CPU_OPERATION(0xCE, DEC_ABS,   3, Modify, DEC, Absolute,            None)
+CPU_OPCODE(0xCF, UNIMP,     1)
+CPU_OPCODE(0xD0, BNE,       2)
+CPU_OPERATION(0xD1, CMP_IND_Y, 2, Read,   CMP, PostIndexedIndirect, Y)
+CPU_OPCODE(0xD2, UNIMP,     1)
+CPU_OPCODE(0xD3, UNIMP,     1)
+CPU_OPCODE(0xD4, UNIMP,     1)
+CPU_OPERATION(0xD5, CMP_ZP_X,  2, Read,   CMP, ZeroPageIndexed,     X)
+CPU_OPERATION(0xD6, DEC_ZP_X,  2, Modify, DEC, ZeroPageIndexed,     X)
+CPU_OPCODE(0xD7, UNIMP,     1)
+CPU_OPCODE(0xD8, CLD,       1)
+CPU_OPERATION(0xD9, CMP_ABS_Y, 3, Read,   CMP, Indexed,             Y)
+CPU_OPCODE(0xDA, NOP,       1)
+CPU_OPCODE(0xDB, UNIMP,     1)
+CPU_OPCODE(0xDC, UNIMP,     1)
+CPU_OPERATION(0xDD, CMP_ABS_X, 3, Read,   CMP, Indexed,             X)
+CPU_OPERATION(0xDE, DEC_ABS_X, 3, Modify, DEC, Indexed,             X)
+CPU_OPCODE(0xDF, UNIMP,     1)
+CPU_OPERATION(0xE0, CPX_IMM,   2, Read,   CPX, Immediate,           None)
+CPU_OPERATION(0xE1, SBC_IND_X, 2, Read,   SBC, PreIndexedIndirect,  X)
+CPU_OPCODE(0xE2, UNIMP,     1)
+CPU_OPCODE(0xE3, UNIMP,     1)
+CPU_OPERATION(0xE4, CPX_ZP,    2, Read,   CPX, ZeroPage,            None)
+CPU_OPERATION(0xE5, SBC_ZP,    2, Read,   SBC, ZeroPage,            None)
+CPU_OPERATION(0xE6, INC_ZP,    2, Modify, INC, ZeroPage,            None)
+CPU_OPCODE(0xE7, UNIMP,     1)
+CPU_OPCODE(0xE8, INX,       1)
+CPU_OPERATION(0xE9, SBC_IMM,   2, Read,   SBC, Immediate,           None)
+CPU_OPCODE(0xEA, NOP,       1)
+CPU_OPCODE(0xEB, UNIMP,     1)
+CPU_OPERATION(0xEC, CPX_ABS,   3, Read,   CPX, Absolute,            None)
+CPU_OPERATION(0xED, SBC_ABS,   3, Read,   SBC, Absolute,            None)
+CPU_OPERATION(0xEE, INC_ABS,   3, Modify, INC, Absolute,            None)
+CPU_OPCODE(0xEF, UNIMP,     1)
+CPU_OPCODE(0xF0, BEQ,       2)
+CPU_OPERATION(0xF1, SBC_IND_Y, 2, Read,   SBC, PostIndexedIndirect, Y)
+CPU_OPCODE(0xF2, UNIMP,     1)
+CPU_OPCODE(0xF3, UNIMP,     1)
+CPU_OPCODE(0xF4, UNIMP,     1)
+CPU_OPERATION(0xF5, SBC_ZP_X,  2, Read,   SBC, ZeroPageIndexed,     X)
+CPU_OPERATION(0xF6, INC_ZP_X,  2, Modify, INC, ZeroPageIndexed,     X)
+CPU_OPCODE(0xF7, UNIMP,     1)
+CPU_OPCODE(0xF8, SED,       1)
+CPU_OPERATION(0xF9, SBC_ABS_Y, 3, Read,   SBC, Indexed,             Y)
+CPU_OPCODE(0xFA, NOP,       1)
+CPU_OPCODE(0xFB, UNIMP,     1)
+CPU_OPCODE(0xFC, UNIMP,     1)
+CPU_OPERATION(0xFD, SBC_ABS_X, 3, Read,   SBC, Indexed,             X)
+CPU_OPERATION(0xFE, INC_ABS_X, 3, Modify, INC, Indexed,             X)
+CPU_OPCODE(0xFF, UNIMP,     1)
+
+#ifdef CPU_FUSED
+CPU_FUSED(DEX_BNE,         0xCA, 0xD0) // delay loops
+CPU_FUSED(DEY_BNE,         0x88, 0xD0)
+CPU_FUSED(INC_ZP_BNE,      0xE6, 0xD0)
+CPU_FUSED(LDA_ABS_BPL,     0xAD, 0x10) // LDA $2002 / BPL: vertical blank wait
+CPU_FUSED(LDA_ABS_STA_ABS, 0xAD, 0x8D) // copies, fused when storing to RAM
+#endif
+
+#ifdef CPU_OPERATION_AS_OPCODE
+#undef CPU_OPERATION
+#undef CPU_OPERATION_AS_OPCODE
+#endif
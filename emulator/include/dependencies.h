@@ -4,6 +4,5 @@
     #include <cstring>
 #else
     #include <circle/util.h>
-    #include <circle/screen.h>
 #endif
 
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "util.h"
+
+namespace Frankenstein {
+
+/**
+ * Timestamped emulator events, in master clock time (PPU dots).
+ *
+ * There is at most one pending event of each kind, scheduling a kind again
+ * moves it. The queue is kept sorted by time in a small array: the run loop
+ * only looks at its first event, to know when to catch the PPU up.
+ */
+class EventQueue {
+public:
+    enum class Event : u8 {
+        Nmi,            // the PPU NMI output reaches the CPU
+        MapperCounter,  // the scanline counter of the cartridge is clocked
+        Count
+    };
+
+    static constexpr u64 Never = ~u64(0);
+
+    EventQueue()
+        : events()
+        , count(0)
+    {
+    }
+
+    /**
+     * @return the time of the next event, Never when the queue is empty
+     */
+    inline u64 NextTime() const
+    {
+        return count != 0 ? events[0].time : Never;
+    }
+
+    /**
+     * Removes the next event
+     */
+    inline Event Pop()
+    {
+        const Event event = events[0].event;
+        Remove(0);
+        return event;
+    }
+
+    void Schedule(const Event event, const u64 time)
+    {
+        Cancel(event);
+        u8 i = count++;
+        for (; i > 0 && events[i - 1].time > time; --i) {
+            events[i] = events[i - 1];
+        }
+        events[i] = { time, event };
+    }
+
+    void Cancel(const Event event)
+    {
+        for (u8 i = 0; i < count; ++i) {
+            if (events[i].event == event) {
+                Remove(i);
+                return;
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        u64 time;
+        Event event;
+    };
+
+    Entry events[static_cast<u8>(Event::Count)];
+    u8 count;
+
+    inline void Remove(u8 i)
+    {
+        for (--count; i < count; ++i) {
+            events[i] = events[i + 1];
+        }
+    }
+};
+
+}
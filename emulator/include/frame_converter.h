@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ppu.h"
+
+namespace Frankenstein {
+
+/**
+ * Layouts of the converted frames, the multi-byte pixels are little-endian
+ */
+enum class PixelFormat : u8 {
+    RGBA8888,   // bytes R, G, B, 0xFF
+    XRGB8888,   // 0xFFRRGGBB words
+    RGB565,     // RRRRRGGG GGGBBBBB words
+    Gray8,      // BT.601 luma byte
+    YUV420,     // BT.601 planes: Y, then U and V at half width and height
+    Count
+};
+
+/**
+ * Conversion of the frames of the PPU, made of system palette indexes, to a
+ * pixel format. Done once per displayed frame, the emulation itself never
+ * converts: headless consumers and skipped frames cost nothing.
+ *
+ * The palette is converted to the format once, the pixels are then looked up
+ * 16 or 32 at a time with byte shuffles, one per byte of the format, with
+ * SSSE3 or AVX2 when the host CPU has them and with NEON when the build
+ * targets it. The chroma of YUV420 averages each 2x2 block, vertically then
+ * horizontally with rounding.
+ */
+class FrameConverter {
+public:
+    explicit FrameConverter(PixelFormat pFormat);
+
+    PixelFormat GetFormat() const
+    {
+        return format;
+    }
+
+    /**
+     * @return the size of a converted frame
+     */
+    u32 FrameBytes() const;
+
+    /**
+     * Converts a frame of Ppu::FramePixels pixels to FrameBytes bytes at out
+     */
+    void Convert(const u8* frame, void* out) const;
+
+    /**
+     * Converts count pixels, for the formats without chroma planes: only the
+     * Y plane of YUV420
+     */
+    void ConvertPixels(const u8* pixels, void* out, u32 count) const;
+
+    /**
+     * @return the size of a pixel, of the Y plane for YUV420
+     */
+    static u32 BytesPerPixel(PixelFormat pixelFormat);
+
+private:
+    PixelFormat format;
+
+    // the palette in the format split by byte: planes[b][i] is the byte b of
+    // the color i, or the Y, U and V planes of YUV420
+    u8 planes[4][64];
+    u8 colors[64][4];   // the palette in the format, color by color
+};
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "cpu.h"
+#include "util.h"
+
+namespace Frankenstein {
+
+class Nes;
+
+/**
+ * Fast-forwarding of the loops games wait in.
+ *
+ * Games wait for the vertical blank or the NMI in loops such as
+ * "LDA $2002 / BPL" or "JMP *". A loop is idle when it is straight-line code
+ * of a read-only page ending with a jump back to its first instruction, only
+ * reading RAM, ROM or the PPU status. Only the CPU changes the RAM and the PPU
+ * status only changes at PPU events, so once an iteration ended in the state
+ * it began with, the next ones are skipped by advancing the master clock until
+ * the next event or until the PPU status read by the loop changes. The CPU
+ * state and the cycle counts are the same as when executing the iterations.
+ */
+class IdleLoop {
+public:
+    explicit IdleLoop(Nes& pNes);
+
+    /**
+     * Skips the iterations of the idle loop at PC that end before the next
+     * event. Must be called before each instruction.
+     * @return true when the master clock was advanced
+     */
+    bool Skip();
+
+    bool enabled;
+    u64 skippedCycles; // CPU cycles fast-forwarded
+
+private:
+    static constexpr u8 MaxInstructions = 8;
+
+    Nes& nes;
+    u16 lastPC;
+
+    // the loop, page is nullptr when there is none
+    const u8* page;
+    u16 head;           // first instruction, target of the jump back
+    u16 tail;           // the jump back
+    u32 iterationDots;
+    bool readsStatus;   // reads $2002
+    u32 statusDots;     // time of the $2002 read from the head
+
+    // state at the head on the previous iteration
+    bool visited;
+    Cpu::Registers registers;
+    u8 status;
+    u64 headClock;
+    bool statusKnown;
+    u8 statusValue;     // PPU status read by the previous iteration
+
+    bool InLoop(const u16 pc) const
+    {
+        return pc >= head && pc <= tail;
+    }
+
+    /**
+     * Finds an idle loop starting at pc
+     * @return false if the code at pc is not an idle loop
+     */
+    bool Analyse(const u16 pc);
+
+    /**
+     * Records the state at the head of the loop
+     */
+    void Visit();
+};
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "bus.h"
+#include "util.h"
+
+namespace Frankenstein {
+
+class Nes;
+
+/**
+ * $2000-$3FFF; NES PPU registers, mirrored every 8 bytes.
+ * The PPU is caught up before every access.
+ */
+class PpuRegisters : public IMemoryListener<u8, u16> {
+public:
+    u8 Read(const u16 address) override;
+    void Write(const u16 address, const u8 value) override;
+
+    explicit PpuRegisters(Nes& pNes);
+
+private:
+    Nes& nes;
+};
+
+/**
+ * $4000-$5FFF; NES APU and I/O registers, followed by the expansion area.
+ * None of the supported cartridges use the expansion area past its first
+ * page: it reads as the high byte of the address (open bus) and ignores
+ * writes.
+ */
+class ApuIoRegisters : public IMemoryListener<u8, u16> {
+public:
+    u8 Read(const u16 address) override;
+    void Write(const u16 address, const u8 value) override;
+
+    explicit ApuIoRegisters(Nes& pNes);
+
+private:
+    Nes& nes;
+    u8 latch[0x100]; // last written values, read back by registers without a device
+};
+
+/**
+ * $8000-$FFFF; cartridge mapper registers, over the PRG ROM read directly
+ * through the page table. The PPU is caught up before every write: the CHR
+ * banks, the mirroring and the scanline counter change from the current dot.
+ */
+class CartridgeRegisters : public IMemoryListener<u8, u16> {
+public:
+    u8 Read(const u16 address) override;
+    void Write(const u16 address, const u8 value) override;
+
+    explicit CartridgeRegisters(Nes& pNes);
+
+private:
+    Nes& nes;
+};
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifdef CPU_JIT
+
+#if !defined(__x86_64__) || !defined(__linux__) || defined(NotNative)
+#error "the recompiler backend is only available on native x86-64 Linux builds"
+#endif
+
+#include "util.h"
+
+namespace Frankenstein {
+
+class Cpu;
+
+/**
+ * Recompiler of hot 6502 basic blocks to x86-64.
+ *
+ * Blocks are found by a hit counter on the PC of the instructions the
+ * interpreter executes. Only code of read-only pages (PRG ROM) is translated,
+ * a block is tagged by its PC and its host page like the decode cache and
+ * never spans more than one page. Instructions the recompiler does not know
+ * end the block, and the translated code exits back to the interpreter before
+ * any access to a page without host memory (I/O registers, mapper writes).
+ * A block only runs when its worst case cycle count ends before the next
+ * event (PPU or queued), so the state seen by the rest of the emulator is the same as
+ * when interpreting.
+ */
+class Jit {
+public:
+    explicit Jit(Cpu& pCpu);
+    ~Jit();
+
+    /**
+     * Runs the translated block at PC if it is hot and ends before budget
+     * @param budget the PPU dots left until the next event
+     * @return the CPU cycles executed, 0 when the interpreter must step
+     */
+    u32 Run(const u64 budget);
+
+    u64 translatedBlocks;
+    u64 executedBlocks;
+
+private:
+    typedef u32 (*NativeBlock)(Cpu* cpu, const u8* const* readPages, u8* const* writePages);
+
+    struct Block {
+        const u8* page;
+        NativeBlock code;
+        u32 maxCycles;
+        u16 pc;
+        u16 hits;
+    };
+
+    static constexpr u32 BlockCount = 4096;
+    static constexpr u16 HotThreshold = 16;
+    static constexpr u32 MaxBlockInstructions = 32;
+    static constexpr u32 MaxBlockSize = 4096;
+    static constexpr u32 ArenaSize = 4 << 20;
+
+    Cpu& cpu;
+    Block blocks[BlockCount];
+
+    u8* arena; // memory the blocks are translated to, executable or writable
+    u32 arenaUsed;
+
+    void Translate(Block& block);
+    void Flush();
+};
+
+}
+
+#endif
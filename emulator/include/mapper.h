@@ -1,11 +1,21 @@
 #pragma once
 
+#include "bus.h"
 #include "rom.h"
 #include "util.h"
 
 namespace Frankenstein {
 
-class Mapper {
+/**
+ * Cartridge hardware.
+ *
+ * A mapper owns the bank pointer tables of the cartridge: the 8 KB PRG windows
+ * seen by the CPU at $8000-$FFFF and the 1 KB CHR windows seen by the PPU at
+ * $0000-$1FFF. The tables are only recomputed on bank switch writes, every
+ * fetch is then a plain table lookup. The PRG windows are mapped directly on
+ * the CPU bus, the mapper only sees the writes to its registers.
+ */
+class Mapper : public IMemoryListener<u8, u16> {
 public:
     enum MirrorMode {
         MirrorHorizontal = 0,
@@ -15,17 +25,86 @@ public:
         MirrorFour = 4
     };
 
-    virtual u8 Read(u16 address) = 0;
-    virtual void Write(u16 address, u8 value) = 0;
+    static constexpr u32 PrgWindowSize = 0x2000;
+    static constexpr u32 ChrWindowSize = 0x0400;
+
+    const u8* prgBanks[4]; // $8000, $A000, $C000, $E000
+    const u8* chrBanks[8]; // $0000, $0400, ..., $1C00
+    MirrorMode mirrorMode;
+
+    bool countsScanlines; // Step is called on the rendered scanlines
+
+    /**
+     * Maps the PRG windows on the CPU bus and registers registers for the
+     * writes to $8000-$FFFF, which forwards them to the mapper. The mapper
+     * interrupts are sent to irqListener.
+     */
+    void Attach(Bus<u8, u16>& cpuBus, IMemoryListener<u8, u16>& registers, IIRQListener& irqListener);
+
+    inline u8 ReadCHR(const u16 address) const
+    {
+        return chrBanks[address >> 10][address & (ChrWindowSize - 1)];
+    }
+
+    /**
+     * Writes to the pattern tables, ignored when the cartridge has CHR ROM
+     */
+    inline void WriteCHR(const u16 address, const u8 value)
+    {
+        if (chrRam != nullptr) {
+            // the banks of a CHR RAM cartridge all point in chrRam
+            const u8* bank = chrBanks[address >> 10];
+            chrRam[(bank - chrRam) + (address & (ChrWindowSize - 1))] = value;
+        }
+    }
+
+    u8 Read(const u16 address) override;
+    virtual void Write(const u16 address, const u8 value) override = 0;
+
+    /**
+     * Clocks the scanline counter, at dot 280 of the rendered scanlines
+     * while the PPU renders. Only called when countsScanlines is set.
+     */
     virtual void Step() = 0;
 
+    explicit Mapper(Rom& pRom);
     virtual ~Mapper() = 0;
+
+protected:
+    Rom& rom;
+    u32 prgSize;
+    u32 chrSize;
+    IIRQListener* irq;
+
+    // Negative banks count from the end of the ROM, out of range banks wrap
+    void SetPRG8K(u8 window, s32 bank);
+    void SetPRG16K(u8 window, s32 bank);
+    void SetPRG32K(s32 bank);
+    void SetCHR1K(u8 window, s32 bank);
+    void SetCHR4K(u8 window, s32 bank);
+    void SetCHR8K(s32 bank);
+
+private:
+    Bus<u8, u16>* bus;
+    u8* chrRam; // 8 KB of CHR RAM for the cartridges without CHR ROM
+
+    u32 BankOffset(s32 bank, u32 bankSize, u32 size) const;
+    void UpdatePRG(u8 window);
+};
+
+// NROM: the banks of the Mapper layout, without registers
+class Mapper0 : public Mapper {
+public:
+    virtual void Write(const u16 address, const u8 value) override;
+    virtual void Step() override;
+
+    explicit Mapper0(Rom& pRom);
+    ~Mapper0() override;
 };
 
 class Mapper1 : public Mapper {
 public:
-    virtual u8 Read(u16 address) override;
-    virtual void Write(u16 address, u8 value) override;
+    virtual void Write(const u16 address, const u8 value) override;
     virtual void Step() override;
 
     void loadRegister(u16 address, u8 value);
@@ -34,17 +113,12 @@ public:
     void writeCHRBank0(u8 value);
     void writeCHRBank1(u8 value);
     void writePRGBank(u8 value);
-    s32 prgBankOffset(s32 index);
-    s32 chrBankOffset(s32 index);
-    void updateOffsets();
-
-    MirrorMode mirrorMode;
+    void updateBanks();
 
-    Mapper1(Rom& pRom);
+    explicit Mapper1(Rom& pRom);
     ~Mapper1() override;
 
 private:
-    Rom& rom;
     u8 shiftRegister;
     u8 control;
     u8 prgMode;
@@ -52,53 +126,52 @@ private:
     u8 prgBank;
     u8 chrBank0;
     u8 chrBank1;
-    u32 prgOffsets[2];
-    u32 chrOffsets[2];
 };
 
 class Mapper2 : public Mapper {
 public:
-    virtual u8 Read(u16 address) override;
-    virtual void Write(u16 address, u8 value) override;
+    virtual void Write(const u16 address, const u8 value) override;
     virtual void Step() override;
 
-    Mapper2(Rom& pRom);
+    explicit Mapper2(Rom& pRom);
     ~Mapper2() override;
-
-private:
-    Rom& rom;
-    u8 prgBanks;
-    u8 prgBank1;
-    u8 prgBank2;
 };
 
 class Mapper3 : public Mapper {
 public:
-    virtual u8 Read(u16 address) override;
-    virtual void Write(u16 address, u8 value) override;
+    virtual void Write(const u16 address, const u8 value) override;
     virtual void Step() override;
 
-    Mapper3();
+    explicit Mapper3(Rom& pRom);
     ~Mapper3() override;
 };
 
 class Mapper4 : public Mapper {
 public:
-    virtual u8 Read(u16 address) override;
-    virtual void Write(u16 address, u8 value) override;
+    virtual void Write(const u16 address, const u8 value) override;
     virtual void Step() override;
 
-    Mapper4();
+    void writeBankSelect(u8 value);
+    void writeBankData(u8 value);
+    void updateBanks();
+
+    explicit Mapper4(Rom& pRom);
     ~Mapper4() override;
+
+private:
+    u8 bankSelect;
+    u8 banks[8];
+    u8 irqReload;
+    u8 irqCounter;
+    bool irqEnable;
 };
 
 class Mapper7 : public Mapper {
 public:
-    virtual u8 Read(u16 address) override;
-    virtual void Write(u16 address, u8 value) override;
+    virtual void Write(const u16 address, const u8 value) override;
     virtual void Step() override;
 
-    Mapper7();
+    explicit Mapper7(Rom& pRom);
     ~Mapper7() override;
 };
 }
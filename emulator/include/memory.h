@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bus.h"
 #include "util.h"
 
 namespace Frankenstein {
@@ -16,6 +17,9 @@ static constexpr u16 ADDR_SRAM = 0x6000;
 static constexpr u16 ADDR_PRG_ROM_LOWER_BANK = 0x8000;
 static constexpr u16 ADDR_PRG_ROM_UPPER_BANK = 0xC000;
 
+static constexpr u16 SIZE_RAM = 0x0800;
+static constexpr u16 SIZE_SRAM = 0x2000;
+
 enum class Addressing {
     Absolute,
     ZeroPage,
@@ -24,6 +28,9 @@ enum class Addressing {
     Indirect,
     PreIndexedIndirect,
     PostIndexedIndirect,
+    // CPU operands without a memory address
+    Immediate,
+    Accumulator,
 };
 
 class Nes;
@@ -31,13 +38,13 @@ class Nes;
 template <typename DataType, typename AddressingType, unsigned int Size>
 class Memory {
 private:
-    DataType raw[Size];
-    Nes& nes;
-
     DataType Read(const AddressingType address);
     void Write(const AddressingType address, const DataType val);
 
 public:
+    // Page table every access goes through
+    Bus<DataType, AddressingType> bus;
+
     // Memory proxy, allow transparent uses of Memory
     struct Ref {
         const AddressingType address;
@@ -66,8 +73,6 @@ public:
 
     Ref operator[](const AddressingType);
 
-    void Copy(const DataType* source, const AddressingType destination, const unsigned int size);
-
     template <Addressing N>
     Ref Get(const DataType);
 
@@ -165,6 +170,12 @@ public:
     //u16 Implied();
     //u16 Accumulator();
     //u16 Relative();
+private:
+    // the backing stores after the page table, which every access reads
+    // first. The PRG ROM is mapped in place from the cartridge.
+    Nes& nes;
+    DataType ram[SIZE_RAM];     // internal work RAM
+    DataType sram[SIZE_SRAM];   // cartridge RAM
 };
 
 }
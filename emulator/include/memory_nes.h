@@ -1,3 +1,5 @@
+#pragma once
+
 #include "memory.h"
 
 namespace Frankenstein {
@@ -6,46 +8,88 @@ template<>
 Memory<u8, u16, 0x10000>::Memory(Nes& pNes);
 
 template <>
-Memory<u8, u16, 0x10000>::Ref Memory<u8, u16, 0x10000>::operator[](const u16 addr);
-
-template <>
-u8 Memory<u8, u16, 0x10000>::Read(const u16 address);
+inline Memory<u8, u16, 0x10000>::Ref Memory<u8, u16, 0x10000>::operator[](const u16 addr)
+{
+    return Ref(addr, this);
+}
 
 template <>
-void Memory<u8, u16, 0x10000>::Write(const u16 address, const u8 val);
+inline u8 Memory<u8, u16, 0x10000>::Read(const u16 address)
+{
+    return bus.Read(address);
+}
 
 template <>
-void Memory<u8, u16, 0x10000>::Copy(const u8* source, const u16 destination, const unsigned int size);
+inline void Memory<u8, u16, 0x10000>::Write(const u16 address, const u8 val)
+{
+    bus.Write(address, val);
+}
 
 template <>
-bool Memory<u8, u16, 0x10000>::IsPageCrossed(u16 startAddress, u16 endAddress);
+inline bool Memory<u8, u16, 0x10000>::IsPageCrossed(u16 startAddress, u16 endAddress)
+{
+    return (startAddress & 0xFF00) != (endAddress & 0xFF00);
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::FromValues(const u8 low);
+inline u16 Memory<u8, u16, 0x10000>::FromValues(const u8 low)
+{
+    u16 res = 0 | low;
+    return res;
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::FromValues(const u8 low, const u8 high);
+inline u16 Memory<u8, u16, 0x10000>::FromValues(const u8 low, const u8 high)
+{
+    u16 res = high;
+    res <<= 8;
+    res |= low;
+    return res;
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::ZeroPage(const u8 low);
+inline u16 Memory<u8, u16, 0x10000>::ZeroPage(const u8 low)
+{
+    return FromValues(low);
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::Absolute(const u8 low, const u8 high);
+inline u16 Memory<u8, u16, 0x10000>::Absolute(const u8 low, const u8 high)
+{
+    return FromValues(low, high);
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::Indexed(const u8 low, const u8 high, const u8 index);
+inline u16 Memory<u8, u16, 0x10000>::Indexed(const u8 low, const u8 high, const u8 index)
+{
+    return FromValues(low, high) + index;
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::ZeroPageIndexed(const u8 low, const u8 index);
+inline u16 Memory<u8, u16, 0x10000>::ZeroPageIndexed(const u8 low, const u8 index)
+{
+    return FromValues(low + index);
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::Indirect(const u8 low, const u8 high);
+inline u16 Memory<u8, u16, 0x10000>::Indirect(const u8 low, const u8 high)
+{
+    auto valLow = Read(FromValues(low, high));
+    auto valHigh = Read(FromValues((low + 1) % 0x100, high));
+    return FromValues(valLow, valHigh);
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::PreIndexedIndirect(const u8 low, const u8 index);
+inline u16 Memory<u8, u16, 0x10000>::PreIndexedIndirect(const u8 low, const u8 index)
+{
+    return Indirect((low + index) % (0x100), 0);
+}
 
 template <>
-u16 Memory<u8, u16, 0x10000>::PostIndexedIndirect(const u8 low, const u8 index);
+inline u16 Memory<u8, u16, 0x10000>::PostIndexedIndirect(const u8 low, const u8 index)
+{
+    return Indirect(low, 0) + index;
+}
 
 template <>
 template <>
@@ -1,31 +1,139 @@
 #pragma once
 
 #include "rom.h"
+#include "mapper.h"
 #include "cpu.h"
 #include "ppu.h"
 #include "memory_nes.h"
 #include "gamepad.h"
-
-class CScreenDevice;
+#include "io_registers.h"
+#include "idle_loop.h"
+#include "event_queue.h"
+#include "jit.h"
 
 namespace Frankenstein {
 
-class Nes
+class Nes final : public IIRQListener
 {
 public:
+    // the state of the run loop first, in the first cache line
+
+    // master clock timestamps, in PPU dots
+    u64 clock;          // time reached by the CPU
+    u64 ppuClock;       // time the PPU has been caught up to
+    u64 deadline;       // time of the next PPU or queued event the CPU can
+                        // observe, 0 while a DMA or an interrupt is pending
+
+#ifdef CPU_JIT
+    Jit* jit;           // nullptr when interpreting only
+#endif
+
+    bool breakpointSet;
+    u16 breakpoint;
+    u8 irqSources;      // IRQSource bits of the devices asserting the IRQ line
+    EventQueue events;  // dispatched when the PPU is caught up to them
+
     Gamepad pad1;
     Gamepad pad2;
+    PpuRegisters ppuRegisters;
+    ApuIoRegisters apuIoRegisters;
+    CartridgeRegisters cartridgeRegisters;
     NesMemory ram;
     const Rom &rom;
+    Mapper* mapper;
     Cpu cpu;
     Ppu ppu;
+    IdleLoop idleLoop;
+
+    enum class StopReason {
+        FrameComplete,
+        BudgetExhausted,
+        Breakpoint
+    };
     
-    CScreenDevice* screen;
-    
+    /**
+     * Upper bound of sizeof(Nes), checked when building: thousands of
+     * consoles of a BatchNes must fit the caches of the host. The frame
+     * buffers and the mapper are allocated apart.
+     */
+    static constexpr u32 SizeBudget = 40 * KILOBYTE;
+
     explicit Nes(Rom &rom);
-    explicit Nes(Rom &rom, CScreenDevice* pScreen);
+    ~Nes();
     
+    /**
+     * Executes one CPU instruction, interrupt or DMA stall and advances the
+     * master clock. The PPU is only caught up when an event is due.
+     */
     void Step();
+
+    /**
+     * Runs until the PPU enters the vertical blank, the front frame buffer
+     * then holds the complete frame
+     * @return FrameComplete, or Breakpoint
+     */
+    StopReason RunFrame();
+
+    /**
+     * Runs at least cycles CPU cycles, up to the first instruction boundary
+     * at or past the budget
+     * @return BudgetExhausted, or Breakpoint
+     */
+    StopReason RunCycles(u64 cycles);
+
+    /**
+     * Stops RunFrame and RunCycles before executing the instruction at
+     * address. The first instruction of a run is always executed, so running
+     * again resumes from a breakpoint. While a breakpoint is set, idle loops
+     * are executed and the instructions are interpreted one at a time.
+     */
+    void SetBreakpoint(u16 address);
+    void ClearBreakpoint();
+
+    /**
+     * Runs the PPU up to the master clock, dispatching the queued events on
+     * the way. Must be called before anything reads or changes the PPU state
+     * (registers, DMA, frame buffers).
+     */
+    void SyncPpu();
+
+    /**
+     * Runs the PPU up to time, ahead of the CPU when nothing the CPU does
+     * before time can change the PPU state
+     */
+    void SyncPpu(u64 time);
+
+    /**
+     * Computes the deadline again from the PPU and the queued events, after
+     * a change of the PPU state: a register write may raise an NMI or move
+     * the next PPU event.
+     */
+    void UpdateDeadline();
+
+    /**
+     * Queues an event, schedule the events through here only: the deadline
+     * is moved to the event when it comes first, so that the CPU stops at it
+     */
+    void Schedule(EventQueue::Event event, u64 time);
+
+    void processIRQ(const u8 source, const bool asserted) override;
+
+#ifdef CPU_JIT
+    /**
+     * Turns the recompilation of hot PRG ROM blocks on or off
+     */
+    void EnableJit(bool enable);
+#endif
+
+private:
+    StopReason Run(u64 until, bool toFrame);
+
+    /**
+     * @return true when the next Step delivers an interrupt or a DMA stall
+     */
+    bool InterruptPending() const;
+
+    void Dispatch(EventQueue::Event event);
 };
 
 }
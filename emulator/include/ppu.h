@@ -8,11 +8,6 @@ class Nes;
 
 class Ppu {
 public:
-    struct BytePair {
-        u8 first;
-        u8 second;
-    };
-
     enum ControlFlags {
         LowerNameTable,         //Name table address, changes between the four name tables at 0x2000 (0), 0x2400 (1), 0x2800 (2) and 0x2C00 (3).
         UpperNameTable,
@@ -42,6 +37,43 @@ public:
         VBlank = 7                  //Indicates whether V-Blank is occurring.
     };
 
+    /**
+     * The scanlines with the same dots, see the dot table in ppu.cpp
+     */
+    enum class LineKind : u8 {
+        Visible,    // 0-239
+        Post,       // 240 and 242-260
+        VBlank,     // 241, sets the vertical blank
+        PreRender,  // 261
+        Count
+    };
+
+    /**
+     * What a dot does. The kinds fetching, rendering or handling the sprites
+     * only act while rendering is on.
+     */
+    enum class DotKind : u8 {
+        Idle,
+        Render,             // dots 1-256 of the visible lines: a pixel and the background fetches
+        Fetch,              // the background fetches without a pixel
+        FetchClearVBlank,   // dot 1 of the pre-render line, clears the vertical blank
+        SetVBlank,          // dot 1 of line 241
+        Sprites,            // dot 257 of the visible lines: copyX, sprite evaluation
+        CopyXNoSprites,     // dot 257 of the pre-render line
+        NoSprites,          // dot 257 of the other lines
+        CopyY,              // dots 280-304 of the pre-render line
+    };
+
+    /**
+     * Entries of the sprite line buffer: the color of the frontmost opaque
+     * sprite pixel in the low nibble
+     */
+    enum SpriteLine : u8 {
+        SpriteColor = 0x0F,
+        SpriteBehind = 0x20,    // behind the opaque background pixels
+        SpriteZero = 0x40,      // from the first sprite of the OAM
+    };
+
     enum SpriteFlags {
         LowerColor,             //Most significant two bits of the color.
         UpperColor,
@@ -50,7 +82,7 @@ public:
         FlipVertical = 7        //Indicates whether to flip the sprite vertically.
     };
 
-    const u16 MirrorLookup[5][4]{
+    static constexpr u16 MirrorLookup[5][4]{
         { 0, 0, 1, 1 },
         { 0, 1, 0, 1 },
         { 0, 0, 0, 0 },
@@ -58,115 +90,39 @@ public:
         { 0, 1, 2, 3 },
     };
 
-#ifndef NotNative
+    // a color of the system palette, see FrameConverter for the output formats
     struct RGBColor {
-        u32 red : 8, 
-            green : 8, 
-            blue : 8, 
-            alpha : 8;
-        
-        RGBColor(): red(0), green(0), blue(0), alpha(0xFF) {
-        }
-        
-        RGBColor(u8 red, u8 green, u8 blue) : red(red), green(green), blue(blue), alpha(0xFF) {
-        }
-    };
-#else
-    struct RGBColor {
-        u32 blue : 8,
-            green : 8,
-            red : 8, 
-            alpha : 8;
-            
-        
-        RGBColor(): blue(0), green(0), red(0), alpha(0) {
+        u8 red;
+        u8 green;
+        u8 blue;
+
+        constexpr RGBColor(): red(0), green(0), blue(0) {
         }
-        
-        RGBColor(u8 red, u8 green, u8 blue) : blue(blue), green(green), red(red),  alpha(0) {
+
+        constexpr RGBColor(u8 red, u8 green, u8 blue) : red(red), green(green), blue(blue) {
         }
     };
-#endif
-
-    const RGBColor systemPalette[0x40] = {
- { 0x6a, 0x6d, 0x6a },
- { 0x00, 0x13, 0x80 },
- { 0x1e, 0x00, 0x8a },
- { 0x39, 0x00, 0x7a },
- { 0x55, 0x00, 0x56 },
- { 0x5a, 0x00, 0x18 },
- { 0x4f, 0x10, 0x00 },
- { 0x38, 0x21, 0x00 },
- { 0x21, 0x33, 0x00 },
- { 0x00, 0x3d, 0x00 },
- { 0x00, 0x40, 0x00 },
- { 0x00, 0x39, 0x24 },
- { 0x00, 0x2e, 0x55 },
- { 0x00, 0x00, 0x00 },
- { 0x00, 0x00, 0x00 },
- { 0x00, 0x00, 0x00 },
- { 0xb9, 0xbc, 0xb9 },
- { 0x18, 0x50, 0xc7 },
- { 0x4b, 0x30, 0xe3 },
- { 0x73, 0x22, 0xd6 },
- { 0x95, 0x1f, 0xa9 },
- { 0x9d, 0x28, 0x5c },
- { 0x96, 0x3c, 0x00 },
- { 0x7a, 0x51, 0x00 },
- { 0x5b, 0x67, 0x00 },
- { 0x22, 0x77, 0x00 },
- { 0x02, 0x7e, 0x02 },
- { 0x00, 0x76, 0x45 },
- { 0x00, 0x6e, 0x8a },
- { 0x00, 0x00, 0x00 },
- { 0x00, 0x00, 0x00 },
- { 0x00, 0x00, 0x00 },
- { 0xff, 0xff, 0xff },
- { 0x68, 0xa6, 0xff },
- { 0x92, 0x99, 0xff },
- { 0xb0, 0x85, 0xff },
- { 0xd9, 0x75, 0xfd },
- { 0xe3, 0x77, 0xb9 },
- { 0xe5, 0x8d, 0x68 },
- { 0xcf, 0xa2, 0x2c },
- { 0xb3, 0xaf, 0x0c },
- { 0x7b, 0xc2, 0x11 },
- { 0x55, 0xca, 0x47 },
- { 0x46, 0xcb, 0x81 },
- { 0x47, 0xc1, 0xc5 },
- { 0x4a, 0x4d, 0x4a },
- { 0x00, 0x00, 0x00 },
- { 0x00, 0x00, 0x00 },
- { 0xff, 0xff, 0xff },
- { 0xcc, 0xea, 0xff },
- { 0xdd, 0xde, 0xff },
- { 0xec, 0xda, 0xff },
- { 0xf8, 0xd7, 0xfe },
- { 0xfc, 0xd6, 0xf5 },
- { 0xfd, 0xdb, 0xcf },
- { 0xf9, 0xe7, 0xb5 },
- { 0xf1, 0xf0, 0xaa },
- { 0xda, 0xfa, 0xa9 },
- { 0xc9, 0xff, 0xbc },
- { 0xc3, 0xfb, 0xd7 },
- { 0xc4, 0xf6, 0xf6 },
- { 0xbe, 0xc1, 0xbe },
- { 0x00, 0x00, 0x00 },
- { 0x00, 0x00, 0x00 }
-    };
+
+    // shared by all the instances, defined in ppu.cpp
+    static const RGBColor systemPalette[0x40];
+
+    static constexpr u32 FrameWidth = 256;
+    static constexpr u32 FrameHeight = 240;
+    static constexpr u32 FramePixels = FrameWidth * FrameHeight;
+    static constexpr u8 Black = 0x3F;   // system palette index
+
     Nes& nes;
 
-    RGBColor* front;
-    RGBColor* back;
+    // frames of system palette indexes, row by row, front is the last
+    // complete one, see FrameConverter
+    u8* front;
+    u8* back;
     
     u32 Cycle;      // 0-340
     u32 ScanLine;   // 0-261, 0-239=visible, 240=post, 241-260=vblank, 261=pre
     u64 Frame;      // frame counter
 
-    // storage variables
-    u8 paletteData[32];
-    u8 nameTableData[2048];
-    u8 oamData[256];
-    u8 chrData[0x2000];
+    bool renderLines; // cleared to run every dot through Step
 
     // PPU registers
     u16 v;      // current vram address (15 bit)
@@ -182,7 +138,6 @@ public:
     bool nmiOutput;
     bool nmiPrevious;
     bool vblankOccured;
-    u8 nmiDelay;
 
     // background temporary variables
     u8 nameTableByte;
@@ -192,11 +147,9 @@ public:
     u64 tileData;
 
     // sprite temporary variables
-    u32 spriteCount;
-    u32 spritePatterns[8];
-    u8 spritePositions[8];
-    u8 spritePriorities[8];
-    u8 spriteIndexes[8];
+    u32 spriteCount;    // sprites on the line, spriteLine is clear when 0
+    bool oamDirty;      // oamData changed since indexSprites
+    u8 indexedSize;     // flagSpriteSize of the sprite index
 
     // $2000 PPUCTRL
     u8 flagNameTable;        // 0: $2000; 1: $2400; 2: $2800; 3: $2C00
@@ -226,7 +179,23 @@ public:
     // $2007 PPUDATA
     u8 bufferedData;  // for buffered reads
 
+    // the sprites of the next rendered line composed by evaluateSprites, a
+    // SpriteLine entry per pixel, 0 when no sprite covers it
+    u8 spriteLine[256];
+
+    // the sprite index built by indexSprites: the first 8 sprites in OAM order
+    // on each visible line and how many are on it
+    u8 lineSprites[240][8];
+    u8 lineSpriteCounts[240];
+
+    // storage variables, after the rendering state so that it fits in the
+    // first cache lines of the object
+    u8 paletteData[32];
+    u8 nameTableData[2048];
+    u8 oamData[256];
+
     explicit Ppu(Nes& pNes);
+    ~Ppu();
 
     void Reset();
     u8 Read(u16 address);
@@ -239,6 +208,7 @@ public:
     void writeControl(u8 value);
     void writeMask(u8 value);
     u8 readStatus();
+    u8 peekStatus() const; // $2002 without the side effects of reading it
     void writeOAMAddress(u8 value);
     u8 readOAMData();
     void writeOAMData(u8 value);
@@ -259,14 +229,59 @@ public:
     void fetchLowTileByte();
     void fetchHighTileByte();
     void storeTileData();
+    void fetchBackground();
     u32 fetchTileData();
     u8 backgroundPixel();
-    BytePair spritePixel();
+    void clearSprites();
     void renderPixel();
     u32 fetchSpritePattern(u8 i, u32 row);
+    void indexSprites();
     void evaluateSprites();
     void tick();
     void Step();
+
+    /**
+     * Runs dots PPU cycles and advances the PPU clock of the Nes, the same as
+     * calling Step dots times. The CPU cannot access the PPU in between: the
+     * visible dots of a scanline are rendered in one pass and the dots
+     * without effect are skipped.
+     */
+    void Run(u32 dots);
+
+    /**
+     * Renders dots 1-256 of a visible scanline, from dot 0, rendering on
+     */
+    void renderLine();
+
+    /**
+     * Number of dots following the current one, on the current scanline,
+     * only moving Cycle forward
+     */
+    u32 idleDots() const;
+
+    /**
+     * Removes the skipped dot of an odd frame from a span of dots starting
+     * at the current one, when the span crosses it. The dot is removed with
+     * rendering off too, as rendering may be enabled before it is reached:
+     * the span is then one dot early, never late.
+     */
+    u32 SkipOddFrameDot(u32 dots) const;
+
+    /**
+     * Number of dots until the next event visible from the CPU side: the
+     * vertical blank being set or cleared. The NMI it raises is delivered
+     * through the event queue of the Nes.
+     * Exact, but one dot early when it crosses the skipped dot of an odd
+     * frame with rendering off.
+     */
+    u32 DotsUntilEvent() const;
+
+    /**
+     * Number of dots until Cycle is next reached, at least one.
+     * Exact, but one dot early when it crosses the skipped dot of an odd
+     * frame with rendering off.
+     */
+    u32 DotsUntilCycle(u32 cycle) const;
 };
 }
 
@@ -19,6 +19,50 @@ union iNesHeader {
     u8 raw[16];
 };
 
+/**
+ * Cartridge image shared by several Rom objects, released by the last one.
+ * The image outlives the consoles using it: they read PRG and CHR in place.
+ * It is created without references, the first Rom takes one.
+ */
+class RomImage {
+public:
+    const u8* const data;
+    const u64 size;
+
+    RomImage(const u8* const pData, u64 pSize)
+        : data(pData)
+        , size(pSize)
+        , references(0)
+    {
+    }
+
+    void Acquire()
+    {
+        __atomic_add_fetch(&references, 1, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Deletes the image when the last reference is released
+     */
+    virtual void Release()
+    {
+        if (__atomic_sub_fetch(&references, 1, __ATOMIC_ACQ_REL) == 0) {
+            delete this;
+        }
+    }
+
+protected:
+    u32 references;
+
+    virtual ~RomImage()
+    {
+    }
+};
+
+/**
+ * An iNES cartridge. PRG and CHR are read in place from the image, the
+ * cartridges with CHR RAM get a writable copy from their mapper.
+ */
 class Rom {
 public:
     //sizes related to rom file format (in bytes) :
@@ -28,25 +72,41 @@ public:
     u32 GetTrainerOffset() const;
     const iNesHeader GetHeader() const;
     const u8* const GetRaw() const;
-    u32 GetLength() const;
-    u8* GetPRG() const;
-    u8* GetCHR() const;
-    u8* GetSRAM() const;
+    u64 GetLength() const;
+    u8 GetMapper() const;
+    const u8* GetPRG() const;
+    const u8* GetCHR() const;
+
+    /**
+     * @return false when the image is not an iNES file or is shorter than its
+     * header says, PRG and CHR are then nullptr
+     */
+    bool IsValid() const;
 
+    /**
+     * The image stays owned by the caller and must outlive the Rom
+     */
     Rom(const u8* const data, u64 size);
-    
+
+    /**
+     * Takes a reference to image
+     */
+    explicit Rom(RomImage* image);
+
+    Rom(const Rom& other);
+    Rom& operator=(const Rom&) = delete;
+    ~Rom();
+
 private:
+    RomImage* const image; // nullptr when the caller owns the data
     const u8* const raw;
     const u64 length;
 
     iNesHeader header;
-    u8* PRG;
-    u8* CHR;
-    u8* SRAM;
+    const u8* PRG;
+    const u8* CHR;
 
     iNesHeader MakeHeader() const;
-    u8* MakePRG() const;
-    u8* MakeCHR() const;
-    u8* MakeSRAM() const;
+    void Validate();
 };
 }
@@ -6,6 +6,12 @@
 namespace Frankenstein {
 
 struct RomLoader {
+    /**
+     * Maps the file read-only. The Rom objects of the same file share one
+     * mapping, unmapped with the last of them.
+     * @return a Rom that is not IsValid() when the file cannot be read or is
+     * not an iNES image
+     */
     static Rom GetRom(std::string file);
 };
 
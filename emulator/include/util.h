@@ -120,6 +120,19 @@ inline bool CheckZero(T src){
     return src == 0;
 }
 
+/**
+ * Return the little endian word at data, as a single 16-bit load whatever
+ * its alignment on little endian hosts.
+ */
+inline u16 LoadWord(const u8* data){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    u16 word;
+    __builtin_memcpy(&word, data, sizeof(word));
+    return word;
+#else
+    return data[0] | (data[1] << 8);
+#endif
+}
 
 //sizes related to hardware (in bytes) :
 const u16 NES_PAGE_SIZE = 256;
@@ -0,0 +1,84 @@
+#include "io_registers.h"
+#include "nes.h"
+
+using namespace Frankenstein;
+
+PpuRegisters::PpuRegisters(Nes& pNes)
+    : nes(pNes)
+{
+}
+
+u8 PpuRegisters::Read(const u16 address)
+{
+    nes.SyncPpu();
+    return nes.ppu.readRegister(address & 0x2007);
+}
+
+void PpuRegisters::Write(const u16 address, const u8 value)
+{
+    nes.SyncPpu();
+    nes.ppu.writeRegister(address & 0x2007, value);
+    nes.UpdateDeadline();
+}
+
+ApuIoRegisters::ApuIoRegisters(Nes& pNes)
+    : nes(pNes)
+    , latch{ 0 }
+{
+}
+
+u8 ApuIoRegisters::Read(const u16 address)
+{
+    if (address >= 0x4100) {
+        return address >> 8;
+    }
+    switch (address) {
+    // $4014; PPU DMA
+    case 0x4014:
+        nes.SyncPpu();
+        nes.ppu.readRegister(address);
+        break;
+    case 0x4016:
+        return nes.pad1.Read();
+    case 0x4017:
+        return nes.pad2.Read();
+    }
+    return latch[address & 0xFF];
+}
+
+void ApuIoRegisters::Write(const u16 address, const u8 value)
+{
+    if (address >= 0x4100) {
+        return;
+    }
+    switch (address) {
+    // $4014; PPU DMA
+    case 0x4014:
+        nes.SyncPpu();
+        nes.ppu.writeRegister(address, value);
+        break;
+    case 0x4016:
+        nes.pad1.Write(value);
+        nes.pad2.Write(value);
+        break;
+    default:
+        latch[address & 0xFF] = value;
+        break;
+    }
+}
+
+CartridgeRegisters::CartridgeRegisters(Nes& pNes)
+    : nes(pNes)
+{
+}
+
+u8 CartridgeRegisters::Read(const u16 address)
+{
+    return nes.mapper->Read(address);
+}
+
+void CartridgeRegisters::Write(const u16 address, const u8 value)
+{
+    nes.SyncPpu();
+    nes.mapper->Write(address, value);
+}
@@ -0,0 +1,973 @@
+#ifdef CPU_JIT
+
+#include "jit.h"
+#include "nes.h"
+
+#include <cstring>
+#include <sys/mman.h>
+
+using namespace Frankenstein;
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+/// x86-64 encoding
+////////////////////////////////////////////////////////////////////////////////
+
+enum Register : u8 {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11
+};
+
+// The /digit of the immediate forms, (digit << 3) | 1 is the register form
+enum Arithmetic : u8 {
+    ADD = 0,
+    OR = 1,
+    AND = 4,
+    SUB = 5,
+    XOR = 6,
+    CMP = 7
+};
+
+enum Condition : u8 {
+    Equal = 0x4,
+    NotEqual = 0x5
+};
+
+/**
+ * Writes the code of a block, at most capacity bytes. The bytes past the
+ * capacity are dropped and set full, the caller rewinds what it emitted.
+ */
+class Emitter {
+public:
+    Emitter(u8* pCode, const u32 pCapacity)
+        : code(pCode)
+        , size(0)
+        , capacity(pCapacity)
+        , full(false)
+    {
+    }
+
+    u8* const code;
+    u32 size;
+    u32 capacity;
+    bool full;
+
+    void Byte(const u8 value)
+    {
+        if (size == capacity) {
+            full = true;
+            return;
+        }
+        code[size++] = value;
+    }
+
+    void Rewind(const u32 pSize)
+    {
+        size = pSize;
+        full = false;
+    }
+
+    void Word(const u16 value)
+    {
+        Byte(value & 0xFF);
+        Byte(value >> 8);
+    }
+
+    void Dword(const u32 value)
+    {
+        for (int i = 0; i < 4; ++i) {
+            Byte((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // movzx dst, byte [base + disp]
+    void LoadByte(const u8 dst, const u8 base, const s32 disp)
+    {
+        Rex(false, dst, 0, base);
+        Byte(0x0F);
+        Byte(0xB6);
+        Displacement(dst, base, disp);
+    }
+
+    // movzx dst, byte [base + index]
+    void LoadByteIndexed(const u8 dst, const u8 base, const u8 index)
+    {
+        Rex(false, dst, index, base);
+        Byte(0x0F);
+        Byte(0xB6);
+        Indexed(dst, base, index, 0);
+    }
+
+    // mov byte [base + disp], src
+    void StoreByte(const u8 base, const s32 disp, const u8 src)
+    {
+        Rex(false, src, 0, base);
+        Byte(0x88);
+        Displacement(src, base, disp);
+    }
+
+    // mov byte [base + index], src
+    void StoreByteIndexed(const u8 base, const u8 index, const u8 src)
+    {
+        Rex(false, src, index, base);
+        Byte(0x88);
+        Indexed(src, base, index, 0);
+    }
+
+    // mov byte [base + disp], value
+    void StoreByteImmediate(const u8 base, const s32 disp, const u8 value)
+    {
+        Rex(false, 0, 0, base);
+        Byte(0xC6);
+        Displacement(0, base, disp);
+        Byte(value);
+    }
+
+    // mov word [base + disp], value
+    void StoreWord(const u8 base, const s32 disp, const u16 value)
+    {
+        Byte(0x66);
+        Rex(false, 0, 0, base);
+        Byte(0xC7);
+        Displacement(0, base, disp);
+        Word(value);
+    }
+
+    // mov dst, qword [base + disp]
+    void LoadPointer(const u8 dst, const u8 base, const s32 disp)
+    {
+        Rex(true, dst, 0, base);
+        Byte(0x8B);
+        Displacement(dst, base, disp);
+    }
+
+    // mov dst, qword [base + index * 8]
+    void LoadPointerIndexed(const u8 dst, const u8 base, const u8 index)
+    {
+        Rex(true, dst, index, base);
+        Byte(0x8B);
+        Indexed(dst, base, index, 3);
+    }
+
+    // mov dst, src
+    void Move(const u8 dst, const u8 src, const bool wide = false)
+    {
+        Rex(wide, src, 0, dst);
+        Byte(0x89);
+        Direct(src, dst);
+    }
+
+    // mov dst, value
+    void MoveImmediate(const u8 dst, const u32 value)
+    {
+        Rex(false, 0, 0, dst);
+        Byte(0xB8 | (dst & 7));
+        Dword(value);
+    }
+
+    // op dst, src
+    void Compute(const Arithmetic op, const u8 dst, const u8 src, const bool wide = false)
+    {
+        Rex(wide, src, 0, dst);
+        Byte((op << 3) | 1);
+        Direct(src, dst);
+    }
+
+    // op dst, value
+    void ComputeImmediate(const Arithmetic op, const u8 dst, const u32 value)
+    {
+        Rex(false, 0, 0, dst);
+        Byte(0x81);
+        Direct(op, dst);
+        Dword(value);
+    }
+
+    // shl dst, count
+    void ShiftLeft(const u8 dst, const u8 count)
+    {
+        Rex(false, 0, 0, dst);
+        Byte(0xC1);
+        Direct(4, dst);
+        Byte(count);
+    }
+
+    // shr dst, count
+    void ShiftRight(const u8 dst, const u8 count)
+    {
+        Rex(false, 0, 0, dst);
+        Byte(0xC1);
+        Direct(5, dst);
+        Byte(count);
+    }
+
+    // not dst
+    void Not(const u8 dst)
+    {
+        Rex(false, 0, 0, dst);
+        Byte(0xF7);
+        Direct(2, dst);
+    }
+
+    // test reg, reg (64 bits)
+    void TestPointer(const u8 reg)
+    {
+        Rex(true, reg, 0, reg);
+        Byte(0x85);
+        Direct(reg, reg);
+    }
+
+    // test byte [base + disp], value
+    void TestByte(const u8 base, const s32 disp, const u8 value)
+    {
+        Rex(false, 0, 0, base);
+        Byte(0xF6);
+        Displacement(0, base, disp);
+        Byte(value);
+    }
+
+    // cmp byte [base + disp], value
+    void CompareByte(const u8 base, const s32 disp, const u8 value)
+    {
+        Rex(false, 0, 0, base);
+        Byte(0x80);
+        Displacement(CMP, base, disp);
+        Byte(value);
+    }
+
+    /**
+     * Short conditional jump forward, to the position given to Bind
+     */
+    u32 Jump(const Condition condition)
+    {
+        Byte(0x70 | condition);
+        Byte(0);
+        return size;
+    }
+
+    void Bind(const u32 jump)
+    {
+        code[jump - 1] = static_cast<u8>(size - jump);
+    }
+
+    void Return()
+    {
+        Byte(0xC3);
+    }
+
+private:
+    void Rex(const bool wide, const u8 reg, const u8 index, const u8 base)
+    {
+        u8 rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+    }
+
+    // [base + disp32], base is never RSP
+    void Displacement(const u8 reg, const u8 base, const s32 disp)
+    {
+        Byte(0x80 | ((reg & 7) << 3) | (base & 7));
+        Dword(static_cast<u32>(disp));
+    }
+
+    // [base + index << scale], base is never RBP
+    void Indexed(const u8 reg, const u8 base, const u8 index, const u8 scale)
+    {
+        Byte(0x04 | ((reg & 7) << 3));
+        Byte((scale << 6) | ((index & 7) << 3) | (base & 7));
+    }
+
+    // register to register
+    void Direct(const u8 reg, const u8 rm)
+    {
+        Byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// 6502 decoding
+////////////////////////////////////////////////////////////////////////////////
+
+enum class Kind {
+    Read,
+    Modify,
+    Store
+};
+
+enum class Operation {
+    ADC, AND, ASL, BIT, CMP, CPX, CPY, DEC, EOR, INC, LDA,
+    LDX, LDY, LSR, ORA, ROL, ROR, SBC, STA, STX, STY
+};
+
+struct OperationInfo {
+    Kind kind;
+    Operation operation;
+    Addressing mode;
+    Cpu::Index index;
+};
+
+/**
+ * The (operation x addressing mode) entries of the opcode table
+ */
+static bool Classify(const u8 opcode, OperationInfo& info)
+{
+    switch (opcode) {
+#define CPU_OPCODE(opcode, handler, size)
+#define CPU_OPERATION(opcode, handler, size, kind, operation, mode, index)                       \
+    case opcode:                                                                                  \
+        info = { Kind::kind, Operation::operation, Addressing::mode, Cpu::Index::index };         \
+        return true;
+#include "cpu_opcodes.h"
+#undef CPU_OPERATION
+#undef CPU_OPCODE
+    }
+    return false;
+}
+
+/**
+ * Translation of the instructions of a block, with the register assignment:
+ *   RDI  the Cpu
+ *   RSI  the read page table
+ *   R9   the write page table
+ *   R10  the cycles executed so far, returned in EAX
+ *   RAX  the operand value
+ *   RCX  the operand offset in its page, RDX its page, for indexed modes
+ *   R8   the write page, R11 the read page, temporaries once the operand
+ *        is loaded
+ */
+class Translator {
+public:
+    // the bytes kept free for the exit of a block that does not end itself
+    static constexpr u32 ExitSize = 16;
+
+    Translator(Cpu& cpu, u8* code, const u32 capacity)
+        : e(code, capacity - ExitSize)
+        , offsetPC(Offset(cpu, &cpu.registers.PC))
+        , offsetSP(Offset(cpu, &cpu.registers.SP))
+        , offsetA(Offset(cpu, &cpu.registers.A))
+        , offsetX(Offset(cpu, &cpu.registers.X))
+        , offsetY(Offset(cpu, &cpu.registers.Y))
+        , offsetP(Offset(cpu, &cpu.registers.P))
+        , offsetZero(Offset(cpu, &cpu.zeroResult))
+        , offsetSign(Offset(cpu, &cpu.signResult))
+        , offsetCycles(Offset(cpu, &cpu.cycles))
+    {
+    }
+
+    Emitter e;
+
+    void Enter()
+    {
+        e.Move(R9, RDX, true);
+        e.Compute(XOR, R10, R10);
+    }
+
+    void Exit(const u16 pc)
+    {
+        e.StoreWord(RDI, offsetPC, pc);
+        e.Move(RAX, R10);
+        e.Return();
+    }
+
+    /**
+     * Ends a block that does not end with a jump, resuming at pc
+     */
+    void End(const u16 pc)
+    {
+        e.capacity += ExitSize;
+        Exit(pc);
+    }
+
+    /**
+     * Emits the instruction at pc
+     * @param cycles set to the worst case cycles of the instruction
+     * @param ends set when the instruction ends the block
+     * @return false if the instruction cannot be translated or does not fit
+     * in the capacity, nothing is emitted
+     */
+    bool Instruction(const u16 pc, const u8 opcode, const u16 operand, u32& cycles, bool& ends)
+    {
+        const u32 start = e.size;
+        if (!Emit(pc, opcode, operand, cycles, ends) || e.full) {
+            e.Rewind(start);
+            ends = false;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const s32 offsetPC;
+    const s32 offsetSP;
+    const s32 offsetA;
+    const s32 offsetX;
+    const s32 offsetY;
+    const s32 offsetP;
+    const s32 offsetZero;
+    const s32 offsetSign;
+    const s32 offsetCycles;
+
+    bool Emit(const u16 pc, const u8 opcode, const u16 operand, u32& cycles, bool& ends)
+    {
+        ends = false;
+        OperationInfo info;
+        if (Classify(opcode, info)) {
+            return Addressed(pc, info, operand, cycles);
+        }
+        if ((opcode & 0x1F) == 0x10) {
+            Branch(pc, opcode, operand);
+            cycles = 4;
+            ends = true;
+            return true;
+        }
+        if (opcode == 0x4C) { // JMP abs
+            Cycles(3);
+            Exit(operand);
+            cycles = 3;
+            ends = true;
+            return true;
+        }
+        cycles = 2;
+        return Implied(opcode);
+    }
+
+    template <typename T>
+    static s32 Offset(Cpu& cpu, T* field)
+    {
+        return static_cast<s32>(reinterpret_cast<u8*>(field) - reinterpret_cast<u8*>(&cpu));
+    }
+
+    void ExitIfNull(const u8 reg, const u16 pc)
+    {
+        e.TestPointer(reg);
+        u32 jump = e.Jump(NotEqual);
+        Exit(pc);
+        e.Bind(jump);
+    }
+
+    /**
+     * Accounts the cycles of an instruction, cpu.cycles holds the last
+     * instruction ones like when interpreting
+     */
+    void Cycles(const u32 count)
+    {
+        e.ComputeImmediate(ADD, R10, count);
+        e.StoreByteImmediate(RDI, offsetCycles, count);
+    }
+
+    void SetZeroAndSign(const u8 reg)
+    {
+        e.StoreByte(RDI, offsetZero, reg);
+        e.StoreByte(RDI, offsetSign, reg);
+    }
+
+    s32 IndexOffset(const Cpu::Index index) const
+    {
+        return index == Cpu::Index::X ? offsetX : offsetY;
+    }
+
+    /**
+     * Computes the page in RDX and the offset in RCX of the indexed modes
+     * @return true when the address is the constant operand
+     */
+    bool Address(const OperationInfo& info, u16& operand)
+    {
+        switch (info.mode) {
+        case Addressing::ZeroPage:
+            operand &= 0xFF;
+            return true;
+        case Addressing::Absolute:
+            return true;
+        case Addressing::ZeroPageIndexed:
+            e.LoadByte(RCX, RDI, IndexOffset(info.index));
+            e.ComputeImmediate(ADD, RCX, operand & 0xFF);
+            e.ComputeImmediate(AND, RCX, 0xFF);
+            e.MoveImmediate(RDX, 0);
+            return false;
+        default: // Indexed
+            e.LoadByte(RCX, RDI, IndexOffset(info.index));
+            e.ComputeImmediate(ADD, RCX, operand);
+            e.Move(RDX, RCX);
+            e.ShiftRight(RDX, 8);
+            e.ComputeImmediate(AND, RDX, 0xFF);
+            e.ComputeImmediate(AND, RCX, 0xFF);
+            return false;
+        }
+    }
+
+    void Page(const u8 dst, const u8 table, const bool constant, const u16 address)
+    {
+        if (constant) {
+            e.LoadPointer(dst, table, (address >> 8) * 8);
+        } else {
+            e.LoadPointerIndexed(dst, table, RDX);
+        }
+    }
+
+    bool Addressed(const u16 pc, const OperationInfo& info, u16 operand, u32& cycles)
+    {
+        switch (info.mode) {
+        case Addressing::Immediate:
+        case Addressing::Accumulator:
+        case Addressing::ZeroPage:
+        case Addressing::ZeroPageIndexed:
+        case Addressing::Absolute:
+        case Addressing::Indexed:
+            break;
+        default:
+            return false;
+        }
+
+        if (info.kind == Kind::Read) {
+            cycles = Cpu::ReadCycles(info.mode) + (info.mode == Addressing::Indexed);
+            if (info.mode == Addressing::Immediate) {
+                e.MoveImmediate(RAX, operand & 0xFF);
+            } else {
+                bool constant = Address(info, operand);
+                Page(R11, RSI, constant, operand);
+                ExitIfNull(R11, pc);
+                if (constant) {
+                    e.LoadByte(RAX, R11, operand & 0xFF);
+                } else {
+                    e.LoadByteIndexed(RAX, R11, RCX);
+                }
+            }
+            Cycles(Cpu::ReadCycles(info.mode));
+            if (info.mode == Addressing::Indexed) {
+                e.ComputeImmediate(CMP, RDX, operand >> 8);
+                u32 jump = e.Jump(Equal);
+                e.ComputeImmediate(ADD, R10, 1);
+                e.StoreByteImmediate(RDI, offsetCycles, cycles);
+                e.Bind(jump);
+            }
+            ReadOperation(info.operation);
+            return true;
+        }
+
+        if (info.kind == Kind::Store) {
+            cycles = Cpu::StoreCycles(info.mode);
+            bool constant = Address(info, operand);
+            Page(R8, R9, constant, operand);
+            ExitIfNull(R8, pc);
+            s32 source = info.operation == Operation::STA ? offsetA : (info.operation == Operation::STX ? offsetX : offsetY);
+            e.LoadByte(RAX, RDI, source);
+            if (constant) {
+                e.StoreByte(R8, operand & 0xFF, RAX);
+            } else {
+                e.StoreByteIndexed(R8, RCX, RAX);
+            }
+            Cycles(cycles);
+            return true;
+        }
+
+        cycles = Cpu::ModifyCycles(info.mode);
+        if (info.mode == Addressing::Accumulator) {
+            e.LoadByte(RAX, RDI, offsetA);
+            ModifyOperation(info.operation);
+            e.StoreByte(RDI, offsetA, RAX);
+        } else {
+            bool constant = Address(info, operand);
+            Page(R11, RSI, constant, operand);
+            ExitIfNull(R11, pc);
+            Page(R8, R9, constant, operand);
+            ExitIfNull(R8, pc);
+            if (constant) {
+                e.LoadByte(RAX, R11, operand & 0xFF);
+            } else {
+                e.LoadByteIndexed(RAX, R11, RCX);
+                e.Compute(ADD, R8, RCX, true);
+            }
+            ModifyOperation(info.operation);
+            e.StoreByte(R8, constant ? (operand & 0xFF) : 0, RAX);
+        }
+        SetZeroAndSign(RAX);
+        Cycles(cycles);
+        return true;
+    }
+
+    /**
+     * The value read is in RAX
+     */
+    void ReadOperation(const Operation operation)
+    {
+        switch (operation) {
+        case Operation::LDA:
+        case Operation::LDX:
+        case Operation::LDY:
+            e.StoreByte(RDI, operation == Operation::LDA ? offsetA : (operation == Operation::LDX ? offsetX : offsetY), RAX);
+            SetZeroAndSign(RAX);
+            break;
+        case Operation::AND:
+        case Operation::ORA:
+        case Operation::EOR:
+            e.LoadByte(RCX, RDI, offsetA);
+            e.Compute(operation == Operation::AND ? AND : (operation == Operation::ORA ? OR : XOR), RCX, RAX);
+            e.StoreByte(RDI, offsetA, RCX);
+            SetZeroAndSign(RCX);
+            break;
+        case Operation::CMP:
+        case Operation::CPX:
+        case Operation::CPY:
+            // C = register >= value, Z and S from the difference
+            e.LoadByte(RCX, RDI, operation == Operation::CMP ? offsetA : (operation == Operation::CPX ? offsetX : offsetY));
+            e.Move(RDX, RCX);
+            e.Compute(SUB, RDX, RAX);
+            e.LoadByte(R8, RDI, offsetP);
+            e.ComputeImmediate(AND, R8, 0xFE);
+            e.Move(RAX, RDX);
+            e.ShiftRight(RAX, 31);
+            e.ComputeImmediate(XOR, RAX, 1);
+            e.Compute(OR, R8, RAX);
+            e.StoreByte(RDI, offsetP, R8);
+            SetZeroAndSign(RDX);
+            break;
+        case Operation::BIT:
+            e.LoadByte(RCX, RDI, offsetA);
+            e.Compute(AND, RCX, RAX);
+            e.StoreByte(RDI, offsetZero, RCX);
+            e.StoreByte(RDI, offsetSign, RAX);
+            e.LoadByte(R8, RDI, offsetP);
+            e.ComputeImmediate(AND, R8, 0xBF);
+            e.ComputeImmediate(AND, RAX, 0x40);
+            e.Compute(OR, R8, RAX);
+            e.StoreByte(RDI, offsetP, R8);
+            break;
+        case Operation::SBC:
+            // A - value - (1 - C) is A + ~value + C
+            e.ComputeImmediate(XOR, RAX, 0xFF);
+        // fall through
+        case Operation::ADC:
+            e.LoadByte(RCX, RDI, offsetA);
+            e.LoadByte(R8, RDI, offsetP);
+            e.Move(RDX, R8);
+            e.ComputeImmediate(AND, RDX, 1);
+            e.Compute(ADD, RDX, RCX);
+            e.Compute(ADD, RDX, RAX);
+            // V = ~(A ^ value) & (A ^ result) & 0x80
+            e.Move(R11, RCX);
+            e.Compute(XOR, R11, RAX);
+            e.Not(R11);
+            e.Compute(XOR, RCX, RDX);
+            e.Compute(AND, RCX, R11);
+            e.ComputeImmediate(AND, RCX, 0x80);
+            e.ShiftRight(RCX, 1);
+            e.ComputeImmediate(AND, R8, 0xBE);
+            e.Compute(OR, R8, RCX);
+            // C = bit 8 of the result
+            e.Move(RCX, RDX);
+            e.ShiftRight(RCX, 8);
+            e.Compute(OR, R8, RCX);
+            e.StoreByte(RDI, offsetP, R8);
+            e.StoreByte(RDI, offsetA, RDX);
+            SetZeroAndSign(RDX);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * The value is in RAX and the result is left in RAX, R8 is preserved
+     */
+    void ModifyOperation(const Operation operation)
+    {
+        switch (operation) {
+        case Operation::INC:
+            e.ComputeImmediate(ADD, RAX, 1);
+            e.ComputeImmediate(AND, RAX, 0xFF);
+            break;
+        case Operation::DEC:
+            e.ComputeImmediate(SUB, RAX, 1);
+            e.ComputeImmediate(AND, RAX, 0xFF);
+            break;
+        case Operation::ASL:
+        case Operation::ROL:
+            e.LoadByte(R11, RDI, offsetP);
+            e.Move(RDX, R11);
+            e.ComputeImmediate(AND, RDX, operation == Operation::ROL ? 1 : 0);
+            e.ComputeImmediate(AND, R11, 0xFE);
+            e.Move(RCX, RAX);
+            e.ShiftRight(RCX, 7);
+            e.Compute(OR, R11, RCX);
+            e.StoreByte(RDI, offsetP, R11);
+            e.ShiftLeft(RAX, 1);
+            e.Compute(OR, RAX, RDX);
+            e.ComputeImmediate(AND, RAX, 0xFF);
+            break;
+        case Operation::LSR:
+        case Operation::ROR:
+            e.LoadByte(R11, RDI, offsetP);
+            e.Move(RDX, R11);
+            e.ComputeImmediate(AND, RDX, operation == Operation::ROR ? 1 : 0);
+            e.ShiftLeft(RDX, 7);
+            e.ComputeImmediate(AND, R11, 0xFE);
+            e.Move(RCX, RAX);
+            e.ComputeImmediate(AND, RCX, 1);
+            e.Compute(OR, R11, RCX);
+            e.StoreByte(RDI, offsetP, R11);
+            e.ShiftRight(RAX, 1);
+            e.Compute(OR, RAX, RDX);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void Branch(const u16 pc, const u8 opcode, const u16 operand)
+    {
+        // taken when the tested flag matches bit 5 of the opcode
+        const bool set = (opcode & 0x20) != 0;
+        switch (opcode >> 6) {
+        case 0: // BPL, BMI
+            e.TestByte(RDI, offsetSign, 0x80);
+            break;
+        case 1: // BVC, BVS
+            e.TestByte(RDI, offsetP, 0x40);
+            break;
+        case 2: // BCC, BCS
+            e.TestByte(RDI, offsetP, 0x01);
+            break;
+        case 3: // BNE, BEQ: Z is set when the result is zero
+            e.CompareByte(RDI, offsetZero, 0);
+            break;
+        }
+        const bool zeroWhenSet = (opcode >> 6) == 3;
+        u32 taken = e.Jump(set != zeroWhenSet ? NotEqual : Equal);
+        Cycles(2);
+        Exit(pc + 2);
+        e.Bind(taken);
+
+        // same timing as the interpreter
+        const s8 offset = static_cast<s8>(operand & 0xFF);
+        const bool pageCrossed = NesMemory::IsPageCrossed(pc + 2, pc + offset);
+        Cycles(3 + pageCrossed);
+        Exit(pc + offset + 2);
+    }
+
+    bool Implied(const u8 opcode)
+    {
+        s32 source;
+        s32 destination;
+        switch (opcode) {
+        case 0xAA: // TAX
+            source = offsetA;
+            destination = offsetX;
+            break;
+        case 0xA8: // TAY
+            source = offsetA;
+            destination = offsetY;
+            break;
+        case 0x8A: // TXA
+            source = offsetX;
+            destination = offsetA;
+            break;
+        case 0x98: // TYA
+            source = offsetY;
+            destination = offsetA;
+            break;
+        case 0xBA: // TSX
+            source = offsetSP;
+            destination = offsetX;
+            break;
+        case 0x9A: // TXS, no flags
+            e.LoadByte(RAX, RDI, offsetX);
+            e.StoreByte(RDI, offsetSP, RAX);
+            Cycles(2);
+            return true;
+        case 0xE8: // INX
+        case 0xCA: // DEX
+            source = destination = offsetX;
+            break;
+        case 0xC8: // INY
+        case 0x88: // DEY
+            source = destination = offsetY;
+            break;
+        case 0x18: // CLC
+        case 0x38: // SEC
+        case 0x58: // CLI
+        case 0x78: // SEI
+        case 0xB8: // CLV
+        case 0xD8: // CLD
+        case 0xF8: // SED
+            Flag(opcode);
+            Cycles(2);
+            return true;
+        case 0xEA: // NOP
+            Cycles(2);
+            return true;
+        default:
+            return false;
+        }
+        e.LoadByte(RAX, RDI, source);
+        if (opcode == 0xE8 || opcode == 0xC8) {
+            e.ComputeImmediate(ADD, RAX, 1);
+        } else if (opcode == 0xCA || opcode == 0x88) {
+            e.ComputeImmediate(SUB, RAX, 1);
+        }
+        e.StoreByte(RDI, destination, RAX);
+        SetZeroAndSign(RAX);
+        Cycles(2);
+        return true;
+    }
+
+    void Flag(const u8 opcode)
+    {
+        u8 mask;
+        switch (opcode) {
+        case 0x18:
+        case 0x38:
+            mask = 0x01;
+            break;
+        case 0x58:
+        case 0x78:
+            mask = 0x04;
+            break;
+        case 0xB8:
+            mask = 0x40;
+            break;
+        default:
+            mask = 0x08;
+            break;
+        }
+        e.LoadByte(RAX, RDI, offsetP);
+        if (opcode == 0x38 || opcode == 0x78 || opcode == 0xF8) {
+            e.ComputeImmediate(OR, RAX, mask);
+        } else {
+            e.ComputeImmediate(AND, RAX, ~mask & 0xFF);
+        }
+        e.StoreByte(RDI, offsetP, RAX);
+    }
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Jit
+////////////////////////////////////////////////////////////////////////////////
+
+Jit::Jit(Cpu& pCpu)
+    : translatedBlocks(0)
+    , executedBlocks(0)
+    , cpu(pCpu)
+    , arenaUsed(0)
+{
+    // never writable and executable at once, Translate opens it for writing
+    void* memory = mmap(nullptr, ArenaSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    arena = memory == MAP_FAILED ? nullptr : static_cast<u8*>(memory);
+    Flush();
+}
+
+Jit::~Jit()
+{
+    if (arena != nullptr) {
+        munmap(arena, ArenaSize);
+    }
+}
+
+void Jit::Flush()
+{
+    memset(blocks, 0, sizeof(blocks));
+    arenaUsed = 0;
+}
+
+u32 Jit::Run(const u64 budget)
+{
+    const u16 pc = cpu.registers.PC;
+    auto& bus = cpu.nes.ram.bus;
+    const u8* page = bus.ReadPage(pc);
+    if (page == nullptr || bus.WritePage(pc) != nullptr) {
+        return 0;
+    }
+
+    Block& block = blocks[pc & (BlockCount - 1)];
+    if (block.pc != pc || block.page != page) {
+        block.page = page;
+        block.pc = pc;
+        block.hits = 1;
+        block.code = nullptr;
+        block.maxCycles = 0;
+        return 0;
+    }
+    if (block.code == nullptr) {
+        if (block.hits != HotThreshold) {
+            block.hits += block.hits < HotThreshold;
+            return 0;
+        }
+        Translate(block);
+        if (block.code == nullptr) {
+            return 0;
+        }
+    }
+    if (u64(block.maxCycles) * 3 >= budget) {
+        return 0;
+    }
+
+    ++executedBlocks;
+    return block.code(&cpu, bus.ReadPages(), bus.WritePages());
+}
+
+void Jit::Translate(Block& block)
+{
+    const u8* page = block.page;
+    u16 pc = block.pc;
+    block.hits = HotThreshold + 1; // translated once, even when it fails
+
+    if (arena == nullptr) {
+        return;
+    }
+    if (arenaUsed + MaxBlockSize > ArenaSize) {
+        Flush();
+        block.page = page;
+        block.pc = pc;
+        block.hits = HotThreshold + 1;
+    }
+
+    if (mprotect(arena, ArenaSize, PROT_READ | PROT_WRITE) != 0) {
+        return;
+    }
+    Translator translator(cpu, arena + arenaUsed, MaxBlockSize);
+    translator.Enter();
+    u32 maxCycles = 0;
+    u32 count = 0;
+    bool ends = false;
+    for (; count < MaxBlockInstructions; ++count) {
+        // the operand bytes must be on the page too
+        const u8 offset = pc & 0xFF;
+        if (offset > 0xFD || (pc >> 8) != (block.pc >> 8)) {
+            break;
+        }
+        const u8 opcode = page[offset];
+        const u16 operand = NesMemory::FromValues(page[offset + 1], page[offset + 2]);
+        u32 cycles;
+        if (!translator.Instruction(pc, opcode, operand, cycles, ends)) {
+            break;
+        }
+        maxCycles += cycles;
+        if (ends) {
+            ++count;
+            break;
+        }
+        pc += cpu.instructions[opcode].size;
+    }
+    if (count != 0 && !ends) {
+        translator.End(pc);
+    }
+    if (mprotect(arena, ArenaSize, PROT_READ | PROT_EXEC) != 0) {
+        // the translated blocks cannot run anymore
+        munmap(arena, ArenaSize);
+        arena = nullptr;
+        Flush();
+        return;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    block.code = reinterpret_cast<NativeBlock>(arena + arenaUsed);
+    block.maxCycles = maxCycles;
+    arenaUsed += translator.e.size;
+    ++translatedBlocks;
+}
+
+#endif
@@ -2,40 +2,150 @@
 
 using namespace Frankenstein;
 
+// PRG of an empty slot, for the images that are not valid cartridges
+static const u8 NoPrg[Mapper::PrgWindowSize] = { 0 };
+
 /**********************************************/
-/***************** MAPPER 1 *******************/
+/****************** MAPPER ********************/
 /**********************************************/
 
-u8 Mapper1::Read(u16 address)
-{
-    if (address < 0x2000) {
-        u16 bank = address / 0x1000;
-        u16 offset = address % 0x1000;
-        return rom.GetCHR()[chrOffsets[bank] + offset];
-    } else if (address >= 0x8000) {
-        address -= 0x8000;
-        u16 bank = address / 0x4000;
-        u16 offset = address % 0x4000;
-        return rom.GetPRG()[prgOffsets[bank] + offset];
-    } else if (address >= 0x6000) {
-        return rom.GetSRAM()[address - 0x6000];
+Mapper::Mapper(Rom& pRom)
+    : countsScanlines(false)
+    , rom(pRom)
+    , irq(nullptr)
+    , bus(nullptr)
+    , chrRam(nullptr)
+{
+    const iNesHeader header = rom.GetHeader();
+    prgSize = rom.IsValid() ? header.prgRomBanks * PRGROM_BANK_SIZE : 0;
+    chrSize = rom.IsValid() ? header.vRomBanks * VROM_BANK_SIZE : 0;
+    if (chrSize == 0) {
+        chrRam = new u8[VROM_BANK_SIZE]{ 0 };
+        chrSize = VROM_BANK_SIZE;
     }
-    return 0;
+
+    if (CheckBit<4>(header.controlByte1)) {
+        mirrorMode = MirrorFour;
+    } else {
+        mirrorMode = CheckBit<1>(header.controlByte1) ? MirrorVertical : MirrorHorizontal;
+    }
+
+    // NROM layout: first and last 16 KB of PRG, first 8 KB of CHR
+    SetPRG16K(0, 0);
+    SetPRG16K(1, -1);
+    SetCHR8K(0);
 }
 
-void Mapper1::Write(u16 address, u8 value)
+Mapper::~Mapper()
 {
-    if (address < 0x2000) {
-        u16 bank = address / 0x1000;
-        u16 offset = address % 0x1000;
-        rom.GetCHR()[chrOffsets[bank] + offset] = value;
-    } else if (address >= 0x8000) {
-        loadRegister(address, value);
-    } else if (address >= 0x6000) {
-        rom.GetSRAM()[address - 0x6000] = value;
+    delete[] chrRam;
+}
+
+void Mapper::Attach(Bus<u8, u16>& cpuBus, IMemoryListener<u8, u16>& registers, IIRQListener& irqListener)
+{
+    irq = &irqListener;
+    bus = &cpuBus;
+    bus->Register(&registers, 0x8000, 0xFFFF);
+    for (u8 window = 0; window < 4; ++window) {
+        UpdatePRG(window);
     }
 }
 
+u8 Mapper::Read(const u16 address)
+{
+    return prgBanks[(address >> 13) & 3][address & (PrgWindowSize - 1)];
+}
+
+u32 Mapper::BankOffset(s32 bank, u32 bankSize, u32 size) const
+{
+    s32 count = size / bankSize;
+    if (count == 0) {
+        return 0;
+    }
+    bank %= count;
+    if (bank < 0) {
+        bank += count;
+    }
+    return bank * bankSize;
+}
+
+void Mapper::UpdatePRG(u8 window)
+{
+    if (bus != nullptr) {
+        u16 first = 0x8000 + window * PrgWindowSize;
+        bus->MapRead(prgBanks[window], PrgWindowSize, first, first + PrgWindowSize - 1);
+    }
+}
+
+void Mapper::SetPRG8K(u8 window, s32 bank)
+{
+    const u8* prg = prgSize != 0 ? rom.GetPRG() : NoPrg;
+    prgBanks[window] = prg + BankOffset(bank, PrgWindowSize, prgSize);
+    UpdatePRG(window);
+}
+
+void Mapper::SetPRG16K(u8 window, s32 bank)
+{
+    SetPRG8K(window * 2, bank * 2);
+    SetPRG8K(window * 2 + 1, bank * 2 + 1);
+}
+
+void Mapper::SetPRG32K(s32 bank)
+{
+    for (u8 i = 0; i < 4; ++i) {
+        SetPRG8K(i, bank * 4 + i);
+    }
+}
+
+void Mapper::SetCHR1K(u8 window, s32 bank)
+{
+    const u8* chr = chrRam != nullptr ? chrRam : rom.GetCHR();
+    chrBanks[window] = chr + BankOffset(bank, ChrWindowSize, chrSize);
+}
+
+void Mapper::SetCHR4K(u8 window, s32 bank)
+{
+    for (u8 i = 0; i < 4; ++i) {
+        SetCHR1K(window * 4 + i, bank * 4 + i);
+    }
+}
+
+void Mapper::SetCHR8K(s32 bank)
+{
+    for (u8 i = 0; i < 8; ++i) {
+        SetCHR1K(i, bank * 8 + i);
+    }
+}
+
+/**********************************************/
+/***************** MAPPER 0 *******************/
+/**********************************************/
+
+// no registers, the writes to the ROM are ignored
+void Mapper0::Write(const u16, const u8)
+{
+}
+
+void Mapper0::Step()
+{
+}
+
+Mapper0::Mapper0(Rom& pRom)
+    : Mapper(pRom)
+{
+}
+
+Mapper0::~Mapper0() {}
+
+/**********************************************/
+/***************** MAPPER 1 *******************/
+/**********************************************/
+
+void Mapper1::Write(const u16 address, const u8 value)
+{
+    loadRegister(address, value);
+}
+
 void Mapper1::Step()
 {
     //do nothing
@@ -65,7 +175,7 @@ void Mapper1::writeRegister(u16 address, u8 value)
         writeCHRBank0(value);
     } else if (address <= 0xDFFF) {
         writeCHRBank1(value);
-    } else if (address <= 0xFFFF) {
+    } else {
         writePRGBank(value);
     }
 }
@@ -91,96 +201,70 @@ void Mapper1::writeControl(u8 value)
         mirrorMode = MirrorHorizontal;
         break;
     }
-    updateOffsets();
+    updateBanks();
 }
 
 // CHR bank 0 (internal, $A000-$BFFF)
 void Mapper1::writeCHRBank0(u8 value)
 {
     chrBank0 = value;
-    updateOffsets();
+    updateBanks();
 }
 
 // CHR bank 1 (internal, $C000-$DFFF)
 void Mapper1::writeCHRBank1(u8 value)
 {
     chrBank1 = value;
-    updateOffsets();
+    updateBanks();
 }
 
 // PRG bank (internal, $E000-$FFFF)
 void Mapper1::writePRGBank(u8 value)
 {
     prgBank = value & 0x0F;
-    updateOffsets();
-}
-
-s32 Mapper1::prgBankOffset(s32 index)
-{
-    if (index >= 0x80) {
-        index -= 0x100;
-    }
-    u32 PRGSize = rom.GetHeader().prgRomBanks * PRGROM_BANK_SIZE;
-    index %= PRGSize / 0x4000;
-    s32 offset = index * 0x4000;
-    if (offset < 0) {
-        offset += PRGSize;
-    }
-    return offset;
-}
-
-s32 Mapper1::chrBankOffset(s32 index)
-{
-    if (index >= 0x80) {
-        index -= 0x100;
-    }
-    u32 CHRSize = rom.GetHeader().vRomBanks * VROM_BANK_SIZE;
-    index %= CHRSize / 0x1000;
-    s32 offset = index * 0x1000;
-    if (offset < 0) {
-        offset += CHRSize;
-    }
-    return offset;
+    updateBanks();
 }
 
 // PRG ROM bank mode (0, 1: switch 32 KB at $8000, ignoring low bit of bank number;
 //                    2: fix first bank at $8000 and switch 16 KB bank at $C000;
 //                    3: fix last bank at $C000 and switch 16 KB bank at $8000)
 // CHR ROM bank mode (0: switch 8 KB at a time; 1: switch two separate 4 KB banks)
-void Mapper1::updateOffsets()
+void Mapper1::updateBanks()
 {
     switch (prgMode) {
     case 0:
     case 1:
-        prgOffsets[0] = prgBankOffset(prgBank & 0xFE);
-        prgOffsets[1] = prgBankOffset(prgBank | 0x01);
+        SetPRG32K(prgBank >> 1);
         break;
     case 2:
-        prgOffsets[0] = 0;
-        prgOffsets[1] = prgBankOffset(prgBank);
+        SetPRG16K(0, 0);
+        SetPRG16K(1, prgBank);
         break;
     case 3:
-        prgOffsets[0] = prgBankOffset(prgBank);
-        prgOffsets[1] = prgBankOffset(-1);
+        SetPRG16K(0, prgBank);
+        SetPRG16K(1, -1);
         break;
     }
     switch (chrMode) {
     case 0:
-        chrOffsets[0] = chrBankOffset(chrBank0 & 0xFE);
-        chrOffsets[1] = chrBankOffset(chrBank0 | 0x01);
+        SetCHR8K(chrBank0 >> 1);
         break;
     case 1:
-        chrOffsets[0] = chrBankOffset(chrBank0);
-        chrOffsets[1] = chrBankOffset(chrBank1);
+        SetCHR4K(0, chrBank0);
+        SetCHR4K(1, chrBank1);
         break;
     }
 }
 
 Mapper1::Mapper1(Rom& pRom)
-    : rom(pRom)
+    : Mapper(pRom)
+    , shiftRegister(0x10)
+    , prgBank(0)
+    , chrBank0(0)
+    , chrBank1(0)
 {
-    shiftRegister = 0x10;
-    prgOffsets[1] = prgBankOffset(-1);
+    // power on in PRG mode 3, last bank fixed at $C000
+    writeControl(0x0C);
 }
 
 Mapper1::~Mapper1() {}
@@ -189,36 +273,10 @@ Mapper1::~Mapper1() {}
 /***************** MAPPER 2 *******************/
 /**********************************************/
 
-u8 Mapper2::Read(u16 address)
-{
-    u16 index;
-    if (address < 0x2000) {
-        return rom.GetCHR()[address];
-    } else if (address >= 0xC000) {
-        index = prgBank2 * 0x4000 + (address - 0xC000);
-        return rom.GetPRG()[index];
-    } else if (address >= 0x8000) {
-        index = prgBank1 * 0x4000 + (address - 0x8000);
-        return rom.GetPRG()[index];
-    } else if (address >= 0x6000) {
-        index = address - 0x6000;
-        return rom.GetSRAM()[index];
-    } else {
-        return 0;
-    }
-}
-
-void Mapper2::Write(u16 address, u8 value)
+// PRG bank select ($8000-$FFFF), last bank fixed at $C000
+void Mapper2::Write(const u16, const u8 value)
 {
-    u16 index;
-    if (address < 0x2000) {
-        rom.GetCHR()[address] = value;
-    } else if (address >= 0x8000) {
-        prgBank1 = value % prgBanks;
-    } else if (address >= 0x6000) {
-        index = address - 0x6000;
-        rom.GetSRAM()[index] = value;
-    }
+    SetPRG16K(0, value);
 }
 
 void Mapper2::Step()
@@ -227,11 +285,8 @@ void Mapper2::Step()
 }
 
 Mapper2::Mapper2(Rom& pRom)
-    : rom(pRom)
+    : Mapper(pRom)
 {
-    prgBanks = rom.GetHeader().prgRomBanks;
-    prgBank1 = 0;
-    prgBank2 = prgBanks - 1;
 }
 
 Mapper2::~Mapper2() {}
@@ -240,16 +295,18 @@ Mapper2::~Mapper2() {}
 /***************** MAPPER 3 *******************/
 /**********************************************/
 
-u8 Mapper3::Read(u16 address)
+// CHR bank select ($8000-$FFFF)
+void Mapper3::Write(const u16, const u8 value)
 {
-    return 0;
+    SetCHR8K(value);
 }
 
-void Mapper3::Write(u16 address, u8 value)
+void Mapper3::Step()
 {
 }
 
-void Mapper3::Step()
+Mapper3::Mapper3(Rom& pRom)
+    : Mapper(pRom)
 {
 }
 
@@ -259,17 +316,91 @@ Mapper3::~Mapper3() {}
 /***************** MAPPER 4 *******************/
 /**********************************************/
 
-u8 Mapper4::Read(u16 address)
+// MMC3: the registers are selected by the address range and its lowest bit
+void Mapper4::Write(const u16 address, const u8 value)
+{
+    const bool even = (address & 1) == 0;
+    if (address < 0xA000) {
+        if (even) {
+            writeBankSelect(value);
+        } else {
+            writeBankData(value);
+        }
+    } else if (address < 0xC000) {
+        // odd: PRG RAM protect, not emulated
+        if (even && mirrorMode != MirrorFour) {
+            mirrorMode = CheckBit<1>(value) ? MirrorHorizontal : MirrorVertical;
+        }
+    } else if (address < 0xE000) {
+        if (even) {
+            irqReload = value;
+        } else {
+            irqCounter = 0; // reloaded on the next scanline
+        }
+    } else {
+        irqEnable = !even;
+        if (even) {
+            irq->processIRQ(IRQMapper, false);
+        }
+    }
+}
+
+// the counter is clocked by the PPU fetching the sprite patterns
+void Mapper4::Step()
 {
-    return 0;
+    if (irqCounter == 0) {
+        irqCounter = irqReload;
+    } else {
+        irqCounter--;
+    }
+    if (irqCounter == 0 && irqEnable) {
+        irq->processIRQ(IRQMapper, true);
+    }
 }
 
-void Mapper4::Write(u16 address, u8 value)
+void Mapper4::writeBankSelect(u8 value)
 {
+    bankSelect = value;
+    updateBanks();
 }
 
-void Mapper4::Step()
+void Mapper4::writeBankData(u8 value)
 {
+    banks[bankSelect & 0x07] = value;
+    updateBanks();
+}
+
+void Mapper4::updateBanks()
+{
+    // PRG: R6 and the second to last bank swap between $8000 and $C000
+    const bool prgSwap = CheckBit<7>(bankSelect);
+    SetPRG8K(0, prgSwap ? -2 : banks[6] & 0x3F);
+    SetPRG8K(1, banks[7] & 0x3F);
+    SetPRG8K(2, prgSwap ? banks[6] & 0x3F : -2);
+    SetPRG8K(3, -1);
+
+    // CHR: the 2 KB banks of R0 and R1 swap with the 1 KB banks of R2-R5
+    const u8 chrSwap = CheckBit<8>(bankSelect) ? 4 : 0;
+    SetCHR1K(0 ^ chrSwap, banks[0] & 0xFE);
+    SetCHR1K(1 ^ chrSwap, banks[0] | 0x01);
+    SetCHR1K(2 ^ chrSwap, banks[1] & 0xFE);
+    SetCHR1K(3 ^ chrSwap, banks[1] | 0x01);
+    SetCHR1K(4 ^ chrSwap, banks[2]);
+    SetCHR1K(5 ^ chrSwap, banks[3]);
+    SetCHR1K(6 ^ chrSwap, banks[4]);
+    SetCHR1K(7 ^ chrSwap, banks[5]);
+}
+
+Mapper4::Mapper4(Rom& pRom)
+    : Mapper(pRom)
+    , bankSelect(0)
+    , banks{ 0, 2, 4, 5, 6, 7, 0, 1 }
+    , irqReload(0)
+    , irqCounter(0)
+    , irqEnable(false)
+{
+    countsScanlines = true;
+    updateBanks();
 }
 
 Mapper4::~Mapper4() {}
@@ -278,17 +409,22 @@ Mapper4::~Mapper4() {}
 /***************** MAPPER 7 *******************/
 /**********************************************/
 
-u8 Mapper7::Read(u16 address)
+// PRG bank select and single screen mirroring ($8000-$FFFF)
+void Mapper7::Write(const u16, const u8 value)
 {
-    return 0;
+    SetPRG32K(value & 0x07);
+    mirrorMode = CheckBit<5>(value) ? MirrorSingle1 : MirrorSingle0;
 }
 
-void Mapper7::Write(u16 address, u8 value)
+void Mapper7::Step()
 {
 }
 
-void Mapper7::Step()
+Mapper7::Mapper7(Rom& pRom)
+    : Mapper(pRom)
 {
+    SetPRG32K(0);
+    mirrorMode = MirrorSingle0;
 }
 
 Mapper7::~Mapper7() {}
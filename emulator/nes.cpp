@@ -1,19 +1,209 @@
 #include "nes.h"
 #include "dependencies.h"
+#include "mapper_factory.h"
 
 using namespace Frankenstein;
 
-Nes::Nes(Rom &pRom) : pad1(), pad2(), ram(*this), rom(pRom), cpu(*this), ppu(*this){
-    screen = nullptr;
+static_assert(sizeof(Nes) <= Nes::SizeBudget, "the state of a console outgrew its budget");
+
+/**
+ * Builds the mapper of the cartridge and plugs it on the CPU bus, before the
+ * CPU reads its reset vector. Unsupported mappers run with the NROM layout.
+ * Invalid images are refused: the slot stays empty, its PRG reads zeros.
+ */
+static Mapper* InsertCartridge(Rom& rom, NesMemory& ram, CartridgeRegisters& registers, IIRQListener& irq)
+{
+    Mapper* mapper = rom.IsValid() ? MapperFactory::MakeMapper(rom.GetMapper(), rom) : nullptr;
+    if (mapper == nullptr) {
+        mapper = MapperFactory::MakeMapper(0, rom);
+    }
+    mapper->Attach(ram.bus, registers, irq);
+    return mapper;
+}
+
+Nes::Nes(Rom &pRom) : pad1(), pad2(), ppuRegisters(*this), apuIoRegisters(*this), cartridgeRegisters(*this), ram(*this), rom(pRom), mapper(InsertCartridge(pRom, ram, cartridgeRegisters, *this)), cpu(*this), ppu(*this), idleLoop(*this){
+    clock = 0;
+    ppuClock = 0;
+    deadline = 0;
+    irqSources = 0;
+    breakpointSet = false;
+    breakpoint = 0;
+#ifdef CPU_JIT
+    jit = nullptr;
+#endif
+    if (mapper->countsScanlines) {
+        Schedule(EventQueue::Event::MapperCounter, ppuClock + ppu.DotsUntilCycle(280));
+    }
 }
 
-Nes::Nes(Rom &pRom, CScreenDevice* pScreen) : pad1(), pad2(), ram(*this), rom(pRom), cpu(*this), ppu(*this){
-    screen = pScreen;
+Nes::~Nes(){
+    delete mapper;
+#ifdef CPU_JIT
+    delete jit;
+#endif
 }
 
 void Nes::Step(){
-    cpu.Step();
-    for(u16 i = 0; i < (cpu.cycles * 3); ++i) {
-        ppu.Step();
+    u8 cycles;
+    if (clock < deadline) {
+        // nothing pending before the next event, fused instruction pairs
+        // stop at breakpoints too
+        u64 budget = 0;
+        if (!breakpointSet) {
+            if (idleLoop.Skip()) {
+                return;
+            }
+#ifdef CPU_JIT
+            // a translated block only runs when it ends before the next event
+            if (jit != nullptr) {
+                u32 jitCycles = jit->Run(deadline - clock);
+                if (jitCycles != 0) {
+                    clock += jitCycles * 3;
+                    return;
+                }
+            }
+#endif
+            budget = deadline - clock;
+        }
+        cycles = cpu.Step(budget);
+    } else if (cpu.stall > 0) {
+        // OAM DMA: the CPU is halted for the whole transfer at once
+        clock += u64(cpu.stall) * 3;
+        cpu.stall = 0;
+        cpu.cycles = 1;
+        SyncPpu();
+        return;
+    } else if (cpu.nmiOccurred) {
+        cpu.nmiOccurred = false;
+        cycles = cpu.cycles = cpu.NMI();
+    } else if (irqSources != 0 && !cpu.Get<Cpu::Flags::I>()) {
+        cycles = cpu.cycles = cpu.IRQ();
+    } else {
+        cycles = cpu.Step();
+    }
+    clock += cycles * 3;
+    if (clock >= deadline) {
+        SyncPpu();
+    }
+}
+
+Nes::StopReason Nes::RunFrame(){
+    return Run(~u64(0), true);
+}
+
+Nes::StopReason Nes::RunCycles(u64 cycles){
+    return Run(clock + cycles * 3, false);
+}
+
+Nes::StopReason Nes::Run(u64 until, bool toFrame){
+    bool vblank = ppu.vblankOccured;
+    bool first = true;
+    while (clock < until) {
+        if (breakpointSet && !first && cpu.registers.PC == breakpoint && !InterruptPending()) {
+            return StopReason::Breakpoint;
+        }
+        first = false;
+        Step();
+        // the vertical blank is a PPU event, the PPU is caught up when it starts
+        if (toFrame && ppu.vblankOccured && !vblank) {
+            return StopReason::FrameComplete;
+        }
+        vblank = ppu.vblankOccured;
+    }
+    return StopReason::BudgetExhausted;
+}
+
+void Nes::SetBreakpoint(u16 address){
+    breakpointSet = true;
+    breakpoint = address;
+}
+
+void Nes::ClearBreakpoint(){
+    breakpointSet = false;
+}
+
+void Nes::SyncPpu(){
+    SyncPpu(clock);
+}
+
+void Nes::SyncPpu(u64 time){
+    while (ppuClock < time) {
+        // the PPU only queues events at its own events, it runs up to the
+        // next one of them without looking at the queue
+        u64 until = ppuClock + ppu.DotsUntilEvent();
+        if (events.NextTime() < until) {
+            until = events.NextTime();
+        }
+        if (time < until) {
+            until = time;
+        }
+        ppu.Run(u32(until - ppuClock));
+        while (events.NextTime() <= ppuClock) {
+            Dispatch(events.Pop());
+        }
+    }
+    UpdateDeadline();
+}
+
+void Nes::UpdateDeadline(){
+    if (cpu.stall > 0 || cpu.nmiOccurred || irqSources != 0) {
+        // a masked IRQ is checked again after each instruction
+        deadline = 0;
+    } else {
+        deadline = ppuClock + ppu.DotsUntilEvent();
+        if (events.NextTime() < deadline) {
+            deadline = events.NextTime();
+        }
+    }
+}
+
+void Nes::Schedule(EventQueue::Event event, u64 time){
+    events.Schedule(event, time);
+    if (time < deadline) {
+        deadline = time;
+    }
+}
+
+void Nes::Dispatch(EventQueue::Event event){
+    switch (event) {
+    case EventQueue::Event::Nmi:
+        // the NMI output may have been turned off since it was raised
+        if (ppu.nmiOutput && ppu.nmiOccurred) {
+            cpu.nmiOccurred = true;
+        }
+        break;
+    case EventQueue::Event::MapperCounter:
+        if (ppu.Cycle == 280 && (ppu.ScanLine < 240 || ppu.ScanLine == 261) &&
+            (ppu.flagShowBackground != 0 || ppu.flagShowSprites != 0)) {
+            mapper->Step();
+        }
+        Schedule(EventQueue::Event::MapperCounter, ppuClock + ppu.DotsUntilCycle(280));
+        break;
+    case EventQueue::Event::Count:
+        break;
+    }
+}
+
+void Nes::processIRQ(const u8 source, const bool asserted){
+    if (asserted) {
+        irqSources |= source;
+        deadline = 0;
+    } else {
+        irqSources &= ~source;
+    }
+}
+
+bool Nes::InterruptPending() const{
+    return cpu.stall > 0 || cpu.nmiOccurred || (irqSources != 0 && !cpu.Get<Cpu::Flags::I>());
+}
+
+#ifdef CPU_JIT
+void Nes::EnableJit(bool enable){
+    if (enable && jit == nullptr) {
+        jit = new Jit(cpu);
+    } else if (!enable) {
+        delete jit;
+        jit = nullptr;
     }
 }
+#endif
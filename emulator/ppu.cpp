@@ -5,35 +5,238 @@
 
 using namespace Frankenstein;
 
-Ppu::Ppu(Nes& pNes)
-    : nes(pNes)
-    , vblankOccured(false)
-{
-    
-#ifndef NotNative
-    front = new RGBColor[256 * 240];
-    back = new RGBColor[256 * 240];
-
-    for (int i = 0; i < 256; ++i) {
-	for (int j = 0; j < 240; j++) {
-	    front[i + 256 * j] = RGBColor();
-	    back[i + 256 * j] = RGBColor();
-	}
+constexpr u16 Ppu::MirrorLookup[5][4];
+constexpr u32 Ppu::FrameWidth;
+constexpr u32 Ppu::FrameHeight;
+constexpr u32 Ppu::FramePixels;
+constexpr u8 Ppu::Black;
+
+const Ppu::RGBColor Ppu::systemPalette[0x40] = {
+ { 0x6a, 0x6d, 0x6a },
+ { 0x00, 0x13, 0x80 },
+ { 0x1e, 0x00, 0x8a },
+ { 0x39, 0x00, 0x7a },
+ { 0x55, 0x00, 0x56 },
+ { 0x5a, 0x00, 0x18 },
+ { 0x4f, 0x10, 0x00 },
+ { 0x38, 0x21, 0x00 },
+ { 0x21, 0x33, 0x00 },
+ { 0x00, 0x3d, 0x00 },
+ { 0x00, 0x40, 0x00 },
+ { 0x00, 0x39, 0x24 },
+ { 0x00, 0x2e, 0x55 },
+ { 0x00, 0x00, 0x00 },
+ { 0x00, 0x00, 0x00 },
+ { 0x00, 0x00, 0x00 },
+ { 0xb9, 0xbc, 0xb9 },
+ { 0x18, 0x50, 0xc7 },
+ { 0x4b, 0x30, 0xe3 },
+ { 0x73, 0x22, 0xd6 },
+ { 0x95, 0x1f, 0xa9 },
+ { 0x9d, 0x28, 0x5c },
+ { 0x96, 0x3c, 0x00 },
+ { 0x7a, 0x51, 0x00 },
+ { 0x5b, 0x67, 0x00 },
+ { 0x22, 0x77, 0x00 },
+ { 0x02, 0x7e, 0x02 },
+ { 0x00, 0x76, 0x45 },
+ { 0x00, 0x6e, 0x8a },
+ { 0x00, 0x00, 0x00 },
+ { 0x00, 0x00, 0x00 },
+ { 0x00, 0x00, 0x00 },
+ { 0xff, 0xff, 0xff },
+ { 0x68, 0xa6, 0xff },
+ { 0x92, 0x99, 0xff },
+ { 0xb0, 0x85, 0xff },
+ { 0xd9, 0x75, 0xfd },
+ { 0xe3, 0x77, 0xb9 },
+ { 0xe5, 0x8d, 0x68 },
+ { 0xcf, 0xa2, 0x2c },
+ { 0xb3, 0xaf, 0x0c },
+ { 0x7b, 0xc2, 0x11 },
+ { 0x55, 0xca, 0x47 },
+ { 0x46, 0xcb, 0x81 },
+ { 0x47, 0xc1, 0xc5 },
+ { 0x4a, 0x4d, 0x4a },
+ { 0x00, 0x00, 0x00 },
+ { 0x00, 0x00, 0x00 },
+ { 0xff, 0xff, 0xff },
+ { 0xcc, 0xea, 0xff },
+ { 0xdd, 0xde, 0xff },
+ { 0xec, 0xda, 0xff },
+ { 0xf8, 0xd7, 0xfe },
+ { 0xfc, 0xd6, 0xf5 },
+ { 0xfd, 0xdb, 0xcf },
+ { 0xf9, 0xe7, 0xb5 },
+ { 0xf1, 0xf0, 0xaa },
+ { 0xda, 0xfa, 0xa9 },
+ { 0xc9, 0xff, 0xbc },
+ { 0xc3, 0xfb, 0xd7 },
+ { 0xc4, 0xf6, 0xf6 },
+ { 0xbe, 0xc1, 0xbe },
+ { 0x00, 0x00, 0x00 },
+ { 0x00, 0x00, 0x00 }
+};
+
+namespace {
+
+using DotKind = Ppu::DotKind;
+using LineKind = Ppu::LineKind;
+
+constexpr u32 LineKinds = static_cast<u32>(LineKind::Count);
+
+/**
+ * What each dot does, by scanline kind and dot, and the number of idle dots
+ * following each dot on its scanline
+ */
+struct DotTable {
+    LineKind lines[262];
+    DotKind kinds[LineKinds][341];
+    u16 idleRuns[2][LineKinds][341]; // by rendering enabled
+};
+
+constexpr DotKind MakeDotKind(const LineKind line, const u32 cycle)
+{
+    const bool renderLine = line == LineKind::Visible || line == LineKind::PreRender;
+    if (renderLine && cycle >= 321 && cycle <= 336) {
+        return DotKind::Fetch;
+    }
+    if (line == LineKind::Visible && cycle >= 1 && cycle <= 256) {
+        return DotKind::Render;
+    }
+    if (line == LineKind::PreRender && cycle == 1) {
+        return DotKind::FetchClearVBlank;
+    }
+    if (line == LineKind::PreRender && cycle >= 2 && cycle <= 256) {
+        return DotKind::Fetch;
+    }
+    if (line == LineKind::PreRender && cycle >= 280 && cycle <= 304) {
+        return DotKind::CopyY;
+    }
+    if (line == LineKind::VBlank && cycle == 1) {
+        return DotKind::SetVBlank;
+    }
+    if (cycle == 257) {
+        return line == LineKind::Visible ? DotKind::Sprites
+            : line == LineKind::PreRender ? DotKind::CopyXNoSprites
+                                          : DotKind::NoSprites;
+    }
+    return DotKind::Idle;
+}
+
+constexpr bool IsIdle(const DotKind kind, const bool renderingEnabled)
+{
+    // the vertical blank flag changes with rendering off too
+    return kind == DotKind::Idle ||
+        (!renderingEnabled && kind != DotKind::SetVBlank && kind != DotKind::FetchClearVBlank);
+}
+
+constexpr DotTable MakeDotTable()
+{
+    DotTable table{};
+    for (u32 line = 0; line < 262; ++line) {
+        table.lines[line] = line < 240 ? LineKind::Visible
+            : line == 241              ? LineKind::VBlank
+            : line == 261              ? LineKind::PreRender
+                                       : LineKind::Post;
+    }
+    for (u32 line = 0; line < LineKinds; ++line) {
+        for (u32 cycle = 0; cycle < 341; ++cycle) {
+            table.kinds[line][cycle] = MakeDotKind(static_cast<LineKind>(line), cycle);
+        }
+        // the last dot of a line is never skipped, Step moves to the next line
+        for (u32 rendering = 0; rendering < 2; ++rendering) {
+            u16 run = 0;
+            table.idleRuns[rendering][line][340] = 0;
+            for (u32 cycle = 340; cycle > 0; --cycle) {
+                run = IsIdle(table.kinds[line][cycle], rendering != 0) && cycle != 340 ? run + 1 : 0;
+                table.idleRuns[rendering][line][cycle - 1] = run;
+            }
+        }
     }
-#endif
+    return table;
+}
 
-    const iNesHeader header = nes.rom.GetHeader();
-    u32 prgRomBanks = header.prgRomBanks;
-    u32 trainerOffset = nes.rom.GetTrainerOffset();
-    u32 vRomBanksLocation = Rom::HeaderSize + trainerOffset + prgRomBanks * PRGROM_BANK_SIZE;
+constexpr DotTable Dots = MakeDotTable();
 
-    for (u32 i = 0; i < 0x2000; ++i) {
-        chrData[i] = nes.rom.GetRaw()[vRomBanksLocation + i];
+/**
+ * A bitplane byte spread to bit 0 of the nibbles of a row of 4-bit pixels,
+ * the leftmost pixel in the highest nibble: bit 7 first, or bit 0 first when
+ * the tile is flipped horizontally
+ */
+struct PlaneTables {
+    u32 normal[256];
+    u32 flipped[256];
+};
+
+constexpr PlaneTables MakePlaneTables()
+{
+    PlaneTables tables{};
+    for (u32 bits = 0; bits < 256; ++bits) {
+        for (u32 i = 0; i < 8; ++i) {
+            if ((bits >> i) & 1) {
+                tables.normal[bits] |= 1u << (i * 4);
+                tables.flipped[bits] |= 1u << ((7 - i) * 4);
+            }
+        }
     }
+    return tables;
+}
+
+constexpr PlaneTables Planes = MakePlaneTables();
+
+inline u32 LineOf(const u32 scanLine)
+{
+    return static_cast<u32>(Dots.lines[scanLine]);
+}
+
+}
+
+Ppu::Ppu(Nes& pNes)
+    : nes(pNes)
+    , renderLines(true)
+    , v(0)
+    , t(0)
+    , x(0)
+    , w(0)
+    , f(0)
+    , reg(0)
+    , nmiOccurred(false)
+    , nmiOutput(false)
+    , nmiPrevious(false)
+    , vblankOccured(false)
+    , nameTableByte(0)
+    , attributeTableByte(0)
+    , lowTileByte(0)
+    , highTileByte(0)
+    , tileData(0)
+    , spriteCount(0)
+    , oamDirty(true)
+    , indexedSize(0)
+    , flagSpriteZeroHit(0)
+    , flagSpriteOverflow(0)
+    , bufferedData(0)
+    , spriteLine()
+    , lineSprites()
+    , lineSpriteCounts()
+    , paletteData()
+    , nameTableData()
+    , oamData()
+{
+    front = new u8[FramePixels];
+    back = new u8[FramePixels];
+    memset(front, Black, FramePixels);
+    memset(back, Black, FramePixels);
 
     Reset();
 }
 
+Ppu::~Ppu()
+{
+    delete[] front;
+    delete[] back;
+}
+
 void Ppu::Reset()
 {
     Cycle = 340;
@@ -48,10 +251,9 @@ u8 Ppu::Read(u16 address)
 {
     u16 temp = address & 0x3FFF; // TODO CONFIRM % 0x4000;
     if (temp < 0x2000) {
-        return chrData[temp];
+        return nes.mapper->ReadCHR(temp);
     } else if (temp < 0x3F00) {
-        u8 mode = CheckBit<1>(nes.rom.GetHeader().controlByte1);
-        return nameTableData[MirrorAddress(mode, temp) & 0x7FF]; // % 2048
+        return nameTableData[MirrorAddress(nes.mapper->mirrorMode, temp) & 0x7FF]; // % 2048
     } else if (temp < 0x4000) {
         return readPalette(temp & 0x1F); // % 20
     }
@@ -62,10 +264,9 @@ void Ppu::Write(u16 address, u8 value)
 {
     u16 temp = address & 0x3FFF; // TODO CONFIRM % 0x4000;
     if (temp < 0x2000) {
-        chrData[temp] = value;
+        nes.mapper->WriteCHR(temp, value);
     } else if (temp < 0x3F00) {
-        u8 mode = CheckBit<1>(nes.rom.GetHeader().controlByte1);
-        nameTableData[MirrorAddress(mode, temp) & 0x7FF] = value;
+        nameTableData[MirrorAddress(nes.mapper->mirrorMode, temp) & 0x7FF] = value;
     } else if (temp < 0x4000) {
         writePalette(temp & 0x1F, value);
     }
@@ -172,6 +373,15 @@ void Ppu::writeMask(u8 value)
 // $2002: PPUSTATUS
 
 u8 Ppu::readStatus()
+{
+    u8 result = peekStatus();
+    nmiOccurred = false;
+    nmiChange();
+    w = 0;
+    return result;
+}
+
+u8 Ppu::peekStatus() const
 {
     u8 result = reg & 0x1F;
     result |= flagSpriteOverflow << 5;
@@ -179,9 +389,6 @@ u8 Ppu::readStatus()
     if (nmiOccurred) {
         result |= 1 << 7;
     }
-    nmiOccurred = false;
-    nmiChange();
-    w = 0;
     return result;
 }
 
@@ -205,6 +412,7 @@ void Ppu::writeOAMData(u8 value)
 {
     oamData[oamAddress] = value;
     oamAddress++;
+    oamDirty = true;
 }
 
 // $2005: PPUSCROLL
@@ -286,11 +494,20 @@ void Ppu::writeData(u8 value)
 void Ppu::writeDMA(u8 value)
 {
     u16 address = u16(value) << 8;
-    for (u16 i = 0; i < 256; i++) {
-        oamData[oamAddress] = nes.ram[address];
-        oamAddress++;
-        address++;
+    const u8* page = nes.ram.bus.ReadPage(address);
+    if (page != nullptr) {
+        // RAM or ROM: block copy, wrapping around the OAM from oamAddress
+        const u16 first = 256 - oamAddress;
+        memcpy(oamData + oamAddress, page, first);
+        memcpy(oamData, page + first, oamAddress);
+    } else {
+        for (u16 i = 0; i < 256; i++) {
+            oamData[oamAddress] = nes.ram[address];
+            oamAddress++;
+            address++;
+        }
     }
+    oamDirty = true;
     /**
      * When sprite DMA ($4014) is written to, 
      * the next instruction always begins on an odd cycle. 
@@ -302,6 +519,7 @@ void Ppu::writeDMA(u8 value)
     if (nes.cpu.cycles & 1) {
         nes.cpu.stall++;
     }
+    nes.deadline = 0; // the stall is taken after this instruction
 }
 
 // NTSC Timing Helper Functions
@@ -370,18 +588,16 @@ void Ppu::nmiChange()
     if (nmi && !nmiPrevious) {
         // TODO: this fixes some games but the delay shouldn't have to be so
         // long, so the timings are off somewhere
-        nmiDelay = 15;
+        nes.Schedule(EventQueue::Event::Nmi, nes.ppuClock + 15);
     }
     nmiPrevious = nmi;
 }
 
 void Ppu::setVerticalBlank()
 {
-#ifndef NotNative
-	auto temp = back;
-	back = front;
-	front = temp;
-#endif
+    u8* temp = back;
+    back = front;
+    front = temp;
     nmiOccurred = true;
     nmiChange();
 
@@ -414,7 +630,7 @@ void Ppu::fetchLowTileByte()
     u8 table = flagBackgroundTable;
     u8 tile = nameTableByte;
     u16 address = 0x1000 * u16(table) + u16(tile) * 16 + fineY;
-    lowTileByte = Read(address);
+    lowTileByte = nes.mapper->ReadCHR(address);
 }
 
 void Ppu::fetchHighTileByte()
@@ -423,22 +639,13 @@ void Ppu::fetchHighTileByte()
     u8 table = flagBackgroundTable;
     u8 tile = nameTableByte;
     u16 address = 0x1000 * u16(table) + u16(tile) * 16 + fineY;
-    highTileByte = Read(address + 8);
+    highTileByte = nes.mapper->ReadCHR(address + 8);
 }
 
 void Ppu::storeTileData()
 {
-    u32 data = 0;
-    for (u8 i = 0; i < 8; i++) {
-        u8 a = attributeTableByte;
-        u8 p1 = (lowTileByte & 0x80) >> 7;
-        u8 p2 = (highTileByte & 0x80) >> 6;
-        lowTileByte <<= 1;
-        highTileByte <<= 1;
-        data <<= 4;
-        data |= u32(a | p1 | p2);
-    }
-    tileData |= u64(data);
+    const u32 pixels = Planes.normal[lowTileByte] | Planes.normal[highTileByte] << 1;
+    tileData |= u64(pixels | attributeTableByte * 0x11111111u);
 }
 
 u32 Ppu::fetchTileData()
@@ -455,34 +662,12 @@ u8 Ppu::backgroundPixel()
     return u8(data & 0x0F);
 }
 
-Ppu::BytePair Ppu::spritePixel()
-{
-    if (flagShowSprites == 0) {
-        return BytePair{ 0, 0 };
-    }
-    for (u32 i = 0; i < spriteCount; i++) {
-        u32 offset = (Cycle - 1) - u32(spritePositions[i]);
-        if (offset < 0 || offset > 7) {
-            continue;
-        }
-        offset = 7 - offset;
-        u8 color = u8((spritePatterns[i] >> u8(offset * 4)) & 0x0F);
-        if ((color & 0x03) == 0) {
-            continue;
-        }
-        return BytePair{ u8(i), color };
-    }
-    return BytePair{ 0, 0 };
-}
-
 void Ppu::renderPixel()
 {
     u32 x = Cycle - 1;
     u32 y = ScanLine;
     u8 background = backgroundPixel();
-    BytePair indexAndSprite = spritePixel();
-    u8 i = indexAndSprite.first;
-    u8 sprite = indexAndSprite.second;
+    u8 sprite = flagShowSprites != 0 ? spriteLine[x] : 0;
     if (x < 8 && flagShowLeftBackground == 0) {
         background = 0;
     }
@@ -490,36 +675,25 @@ void Ppu::renderPixel()
         sprite = 0;
     }
     bool b = (background & 0x03) != 0; // % 4 != 0
-    bool s = (sprite & 0x03) != 0;
+    bool s = sprite != 0;
     u8 color;
     if (!b && !s) {
         color = 0;
     } else if (!b && s) {
-        color = sprite | 0x10;
+        color = (sprite & SpriteColor) | 0x10;
     } else if (b && !s) {
         color = background;
     } else {
-        if (spriteIndexes[i] == 0 && x < 255) {
+        if ((sprite & SpriteZero) != 0 && x < 255) {
             flagSpriteZeroHit = 1;
         }
-        if (spritePriorities[i] == 0) {
-            color = sprite | 0x10;
+        if ((sprite & SpriteBehind) == 0) {
+            color = (sprite & SpriteColor) | 0x10;
         } else {
             color = background;
         }
     }
-    RGBColor c = systemPalette[readPalette(u16(color)) & 0x3F]; // % 64
-#ifndef NotNative
-    back[x + 256 * y] = c;
-#else
-    auto col = *(u32*)&c;
-    if (nes.screen->GetPixel(x * 2, y * 2) != col){
-	nes.screen->SetPixel(x * 2, y * 2, col);
-	nes.screen->SetPixel(x * 2 + 1, y * 2, col);
-	nes.screen->SetPixel(x * 2, y * 2 + 1, col);
-	nes.screen->SetPixel(x * 2 + 1, y * 2 + 1, col);
-    }
-#endif
+    back[x + FrameWidth * y] = readPalette(u16(color)) & 0x3F; // % 64
 }
 
 u32 Ppu::fetchSpritePattern(u8 i, u32 row)
@@ -545,72 +719,75 @@ u32 Ppu::fetchSpritePattern(u8 i, u32 row)
         }
         address = 0x1000 * u16(table) + u16(tile) * 16 + u16(row);
     }
-    u8 a = (attributes & 3) << 2;
-    lowTileByte = Read(address);
-    highTileByte = Read(address + 8);
-    u32 data = 0;
-    for (u8 i = 0; i < 8; i++) {
-        u8 p1, p2;
-        if ((attributes & 0x40) == 0x40) {
-            p1 = (lowTileByte & 1) << 0;
-            p2 = (highTileByte & 1) << 1;
-            lowTileByte >>= 1;
-            highTileByte >>= 1;
-        } else {
-            p1 = (lowTileByte & 0x80) >> 7;
-            p2 = (highTileByte & 0x80) >> 6;
-            lowTileByte <<= 1;
-            highTileByte <<= 1;
+    // the pattern tables, without the decoding of the PPU address space
+    const u8 low = nes.mapper->ReadCHR(address);
+    const u8 high = nes.mapper->ReadCHR(address + 8);
+    const u32* planes = (attributes & 0x40) == 0x40 ? Planes.flipped : Planes.normal;
+    return planes[low] | planes[high] << 1 | ((attributes & 3) << 2) * 0x11111111u;
+}
+
+// indexSprites buckets the sprites by the visible lines they cover, OAM only
+// changes about once per frame so that each line only looks at its sprites
+
+void Ppu::indexSprites()
+{
+    const u32 h = flagSpriteSize == 0 ? 8 : 16;
+    memset(lineSpriteCounts, 0, sizeof(lineSpriteCounts));
+    for (u8 i = 0; i < 64; i++) {
+        const u32 y = oamData[i * 4 + 0];
+        for (u32 line = y; line < y + h && line < 240; ++line) {
+            const u8 count = lineSpriteCounts[line]++;
+            if (count < 8) {
+                lineSprites[line][count] = i;
+            }
         }
-        data <<= 4;
-        data |= u32(a | p1 | p2);
     }
-    return data;
+    oamDirty = false;
+    indexedSize = flagSpriteSize;
 }
 
 void Ppu::evaluateSprites()
 {
-    u32 h;
-    if (flagSpriteSize == 0) {
-        h = 8;
-    } else {
-        h = 16;
-    }
-    u8 count = 0;
-    for (u8 i = 0; i < 64; i++) {
-        u8 y = oamData[i * 4 + 0];
-        u8 a = oamData[i * 4 + 2];
-        u8 x = oamData[i * 4 + 3];
-        u32 row = ScanLine - u32(y);
-        if (row < 0 || row >= h) {
-            continue;
-        }
-        if (count < 8) {
-            spritePatterns[count] = fetchSpritePattern(i, row);
-            spritePositions[count] = x;
-            spritePriorities[count] = (a >> 5) & 1;
-            spriteIndexes[count] = u8(i);
-        }
-        count++;
+    clearSprites();
+    if (oamDirty || indexedSize != flagSpriteSize) {
+        indexSprites();
     }
+    u8 count = lineSpriteCounts[ScanLine];
     if (count > 8) {
         count = 8;
         flagSpriteOverflow = 1;
     }
+    for (u8 j = 0; j < count; j++) {
+        const u8 i = lineSprites[ScanLine][j];
+        const u8 y = oamData[i * 4 + 0];
+        const u8 a = oamData[i * 4 + 2];
+        const u8 x = oamData[i * 4 + 3];
+        // composed front to back: a pixel already covered by a sprite of a
+        // lower index stays in front
+        const u32 pattern = fetchSpritePattern(i, ScanLine - u32(y));
+        const u8 flags = (((a >> 5) & 1) != 0 ? SpriteBehind : 0) | (i == 0 ? SpriteZero : 0);
+        for (u32 pixel = 0; pixel < 8 && x + pixel < 256; ++pixel) {
+            const u8 color = u8((pattern >> ((7 - pixel) * 4)) & 0x0F);
+            if ((color & 0x03) != 0 && spriteLine[x + pixel] == 0) {
+                spriteLine[x + pixel] = color | flags;
+            }
+        }
+    }
     spriteCount = count;
 }
 
+void Ppu::clearSprites()
+{
+    if (spriteCount != 0) {
+        memset(spriteLine, 0, sizeof(spriteLine));
+        spriteCount = 0;
+    }
+}
+
 // tick updates Cycle, ScanLine and Frame counters
 
 void Ppu::tick()
 {
-    if (nmiDelay > 0) {
-        nmiDelay--;
-        if (nmiDelay == 0 && nmiOutput && nmiOccurred) {
-            nes.cpu.nmiOccurred = true;
-        }
-    }
-
     if (f == 1 && ScanLine == 261 && Cycle == 339 && (flagShowBackground != 0 || flagShowSprites != 0)) {
         Cycle = 0;
         ScanLine = 0;
@@ -630,78 +807,203 @@ void Ppu::tick()
     }
 }
 
+// fetchBackground runs the background fetch of the current dot
+
+void Ppu::fetchBackground()
+{
+    tileData <<= 4;
+    switch (Cycle & 0x07) { // % 8
+    case 1:
+        fetchNameTableByte();
+        break;
+    case 3:
+        fetchAttributeTableByte();
+        break;
+    case 5:
+        fetchLowTileByte();
+        break;
+    case 7:
+        fetchHighTileByte();
+        break;
+    case 0:
+        storeTileData();
+        incrementX();
+        if (Cycle == 256) {
+            incrementY();
+        }
+        break;
+    }
+}
+
 // Step executes a single PPU cycle
 
 void Ppu::Step()
 {
     tick();
 
-    bool renderingEnabled = flagShowBackground != 0 || flagShowSprites != 0;
-    bool preLine = ScanLine == 261;
-    bool visibleLine = ScanLine < 240;
-    // postLine := ScanLine == 240
-    bool renderLine = preLine || visibleLine;
-    bool preFetchCycle = Cycle >= 321 && Cycle <= 336;
-    bool visibleCycle = Cycle >= 1 && Cycle <= 256;
-    bool fetchCycle = preFetchCycle || visibleCycle;
-
-    // background logic
-    if (renderingEnabled) {
-        if (visibleLine && visibleCycle) {
+    const bool renderingEnabled = flagShowBackground != 0 || flagShowSprites != 0;
+    switch (Dots.kinds[LineOf(ScanLine)][Cycle]) {
+    case DotKind::Idle:
+        break;
+    case DotKind::Render:
+        if (renderingEnabled) {
             renderPixel();
+            fetchBackground();
         }
-        if (renderLine && fetchCycle) {
-            tileData <<= 4;
-            switch (Cycle & 0x07) { // % 8
-            case 1:
-                fetchNameTableByte();
-                break;
-            case 3:
-                fetchAttributeTableByte();
-                break;
-            case 5:
-                fetchLowTileByte();
-                break;
-            case 7:
-                fetchHighTileByte();
-                break;
-            case 0:
-                storeTileData();
-                break;
-            }
+        break;
+    case DotKind::Fetch:
+        if (renderingEnabled) {
+            fetchBackground();
+        }
+        break;
+    case DotKind::FetchClearVBlank:
+        if (renderingEnabled) {
+            fetchBackground();
         }
-        if (preLine && Cycle >= 280 && Cycle <= 304) {
+        clearVerticalBlank();
+        flagSpriteZeroHit = 0;
+        flagSpriteOverflow = 0;
+        break;
+    case DotKind::SetVBlank:
+        setVerticalBlank();
+        break;
+    case DotKind::Sprites:
+        if (renderingEnabled) {
+            copyX();
+            evaluateSprites();
+        }
+        break;
+    case DotKind::CopyXNoSprites:
+        if (renderingEnabled) {
+            copyX();
+            clearSprites();
+        }
+        break;
+    case DotKind::NoSprites:
+        if (renderingEnabled) {
+            clearSprites();
+        }
+        break;
+    case DotKind::CopyY:
+        if (renderingEnabled) {
             copyY();
         }
-        if (renderLine) {
-            if (fetchCycle && (Cycle & 0x07) == 0) { // % 8
-                incrementX();
-            }
-            if (Cycle == 256) {
-                incrementY();
-            }
-            if (Cycle == 257) {
-                copyX();
-            }
+        break;
+    }
+}
+
+void Ppu::Run(u32 dots)
+{
+    while (dots != 0) {
+        const bool renderingEnabled = flagShowBackground != 0 || flagShowSprites != 0;
+        if (renderLines && renderingEnabled && ScanLine < 240 && Cycle == 0 && dots >= 256) {
+            nes.ppuClock += 256;
+            renderLine();
+            dots -= 256;
+            continue;
         }
+        u32 idle = renderLines ? idleDots() : 0;
+        if (idle == 0) {
+            ++nes.ppuClock;
+            Step();
+            --dots;
+            continue;
+        }
+        if (idle > dots) {
+            idle = dots;
+        }
+        nes.ppuClock += idle;
+        Cycle += idle;
+        dots -= idle;
     }
+}
 
-    // sprite logic
-    if (Cycle == 257 && renderingEnabled) {
-        if (visibleLine) {
-            evaluateSprites();
-        } else {
-            spriteCount = 0;
+void Ppu::renderLine()
+{
+    for (u32 tile = 0; tile < 32; ++tile) {
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+        fetchNameTableByte();
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+        fetchAttributeTableByte();
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+        fetchLowTileByte();
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+        fetchHighTileByte();
+
+        ++Cycle;
+        renderPixel();
+        tileData <<= 4;
+        storeTileData();
+        incrementX();
+    }
+    incrementY();
+}
+
+u32 Ppu::idleDots() const
+{
+    const bool renderingEnabled = flagShowBackground != 0 || flagShowSprites != 0;
+    return Dots.idleRuns[renderingEnabled][LineOf(ScanLine)][Cycle];
+}
+
+u32 Ppu::DotsUntilEvent() const
+{
+    const u32 dotsPerFrame = 341 * 262;
+    const u32 position = ScanLine * 341 + Cycle;
+    const u32 events[] = { 241 * 341 + 1, 261 * 341 + 1 };
+
+    u32 dots = dotsPerFrame;
+    for (u32 event : events) {
+        u32 distance = (event + dotsPerFrame - position) % dotsPerFrame;
+        if (distance == 0) {
+            distance = dotsPerFrame;
+        }
+        if (distance < dots) {
+            dots = distance;
         }
     }
+    return SkipOddFrameDot(dots);
+}
 
-    // vblank logic
-    if (ScanLine == 241 && Cycle == 1) {
-        setVerticalBlank();
+u32 Ppu::DotsUntilCycle(u32 cycle) const
+{
+    u32 dots = (cycle + 341 - Cycle) % 341;
+    if (dots == 0) {
+        dots = 341;
     }
-    if (preLine && Cycle == 1) {
-        clearVerticalBlank();
-        flagSpriteZeroHit = 0;
-        flagSpriteOverflow = 0;
+    return SkipOddFrameDot(dots);
+}
+
+u32 Ppu::SkipOddFrameDot(u32 dots) const
+{
+    // the tick from dot 339 of the pre-render line of odd frames moves two
+    // dots, the spans never cross it from the previous frame
+    const u32 position = ScanLine * 341 + Cycle;
+    const u32 skipped = 261 * 341 + 339;
+    if (f == 1 && position <= skipped && skipped - position + 1 < dots) {
+        dots--;
     }
+    return dots;
 }
@@ -3,13 +3,65 @@
 using namespace Frankenstein;
 
 Rom::Rom(u8 const* const raw, u64 size)
-    : raw(raw)
+    : image(nullptr)
+    , raw(raw)
     , length(size)
+{
+    Validate();
+}
+
+Rom::Rom(RomImage* pImage)
+    : image(pImage)
+    , raw(pImage->data)
+    , length(pImage->size)
+{
+    image->Acquire();
+    Validate();
+}
+
+Rom::Rom(const Rom& other)
+    : image(other.image)
+    , raw(other.raw)
+    , length(other.length)
+    , header(other.header)
+    , PRG(other.PRG)
+    , CHR(other.CHR)
+{
+    if (image != nullptr) {
+        image->Acquire();
+    }
+}
+
+Rom::~Rom()
+{
+    if (image != nullptr) {
+        image->Release();
+    }
+}
+
+void Rom::Validate()
 {
     this->header = MakeHeader();
-    this->PRG = MakePRG();
-    this->CHR = MakeCHR();
-    this->SRAM = MakeSRAM();
+    this->PRG = nullptr;
+    this->CHR = nullptr;
+
+    const u8* magic = this->header.magicWord;
+    if (magic[0] != 'N' || magic[1] != 'E' || magic[2] != 'S' || magic[3] != 0x1A ||
+        this->header.prgRomBanks == 0) {
+        return;
+    }
+    const u64 prgOffset = Rom::HeaderSize + GetTrainerOffset();
+    const u64 chrOffset = prgOffset + u64(this->header.prgRomBanks) * PRGROM_BANK_SIZE;
+    if (chrOffset + u64(this->header.vRomBanks) * VROM_BANK_SIZE > this->length) {
+        return;
+    }
+    this->PRG = GetRaw() + prgOffset;
+    this->CHR = GetRaw() + chrOffset;
+}
+
+bool Rom::IsValid() const
+{
+    return this->PRG != nullptr;
 }
 
 const iNesHeader Rom::GetHeader() const {
@@ -20,57 +72,28 @@ const u8* const Rom::GetRaw() const {
     return this->raw;
 };
 
-u32 Rom::GetLength() const {
+u64 Rom::GetLength() const {
     return this->length;
 }
 
-u8* Rom::GetPRG() const {
-    return this->PRG;
-}
-
-u8* Rom::GetCHR() const {
-    return this->CHR;
-}
-
-u8* Rom::GetSRAM() const {
-    return this->SRAM;
-}
-
-u8* Rom::MakePRG() const
-{
-    iNesHeader header = GetHeader();
-    u8 prgRomBanks = header.prgRomBanks;
-    u32 trainerOffset = GetTrainerOffset();
-    u32 prgRomBanksLocation = Rom::HeaderSize + trainerOffset;
-    u8* PRG = new u8[PRGROM_BANK_SIZE * prgRomBanks];
-    for (u32 i = 0; i < PRGROM_BANK_SIZE * prgRomBanks; ++i) {
-        PRG[i] = GetRaw()[i + prgRomBanksLocation];
-    }
-    return PRG;
+u8 Rom::GetMapper() const {
+    return (this->header.controlByte1 >> 4) | (this->header.controlByte2 & 0xF0);
 }
 
-u8* Rom::MakeCHR() const
-{
-    iNesHeader header = GetHeader();
-    u8 prgRomBanks = header.prgRomBanks;
-    u8 vRomBanks = header.vRomBanks;
-    u32 trainerOffset = GetTrainerOffset();
-    u32 vRomBanksLocation = Rom::HeaderSize + trainerOffset + prgRomBanks * PRGROM_BANK_SIZE;
-    u8* CHR = new u8[VROM_BANK_SIZE * vRomBanks];
-    for (u32 i = 0; i < VROM_BANK_SIZE * vRomBanks; ++i) {
-        CHR[i] = GetRaw()[i + vRomBanksLocation];
-    }
-    return CHR;
+const u8* Rom::GetPRG() const {
+    return this->PRG;
 }
 
-u8* Rom::MakeSRAM() const
-{
-    return new u8[0x2000];
+const u8* Rom::GetCHR() const {
+    return this->CHR;
 }
 
 iNesHeader Rom::MakeHeader() const
 {
-    iNesHeader header;
+    iNesHeader header = {};
+    if (this->length < sizeof(iNesHeader)) {
+        return header;
+    }
     u8 const* const raw = this->GetRaw();
     for (u32 i = 0; i < sizeof(iNesHeader); ++i) {
         header.raw[i] = raw[i];
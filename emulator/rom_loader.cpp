@@ -2,20 +2,100 @@
 
 #include "util.h"
 #include "rom.h"
-#include <cstdio>
+
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
 
 using namespace Frankenstein;
 
-Frankenstein::Rom RomLoader::GetRom(std::string file) {
-    FILE *f = fopen(file.c_str(), "rb");
-    fseek(f, 0, SEEK_END);
-    long fsize = ftell(f);
-    fseek(f, 0, SEEK_SET);  //same as rewind(f);
+namespace {
+
+using FileId = std::pair<dev_t, ino_t>;
+
+class MappedFile;
+
+std::mutex mappingsLock;
+std::map<FileId, MappedFile*> mappings; // files currently mapped
+
+/**
+ * A ROM file mapped read-only, shared by the Rom objects loading the same
+ * file until the last one is destroyed
+ */
+class MappedFile : public RomImage {
+public:
+    MappedFile(const FileId pId, const u8* const pData, u64 pSize)
+        : RomImage(pData, pSize)
+        , id(pId)
+    {
+    }
+
+    void Release() override
+    {
+        std::lock_guard<std::mutex> lock(mappingsLock);
+        if (__atomic_sub_fetch(&references, 1, __ATOMIC_ACQ_REL) == 0) {
+            mappings.erase(id);
+            delete this;
+        }
+    }
 
-    auto data = new u8[fsize];
+private:
+    const FileId id;
 
-    fread(data, fsize, 1, f);
-    fclose(f);
+    ~MappedFile() override
+    {
+        munmap(const_cast<u8*>(data), size);
+    }
+};
+
+/**
+ * @return the mapping of the file with a reference taken, or nullptr when
+ * the file cannot be mapped
+ */
+MappedFile* FindOrMap(const FileId id, int fd, off_t size)
+{
+    std::lock_guard<std::mutex> lock(mappingsLock);
+    auto mapped = mappings.find(id);
+    if (mapped != mappings.end()) {
+        mapped->second->Acquire();
+        return mapped->second;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    MappedFile* image = new MappedFile(id, static_cast<const u8*>(data), size);
+    image->Acquire();
+    mappings[id] = image;
+    return image;
+}
+
+}
+
+Frankenstein::Rom RomLoader::GetRom(std::string file) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Rom(nullptr, 0);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(Rom::HeaderSize)) {
+        close(fd);
+        return Rom(nullptr, 0);
+    }
 
-    return Rom(data, fsize);
+    // the Rom is built once the lock is released, the reference taken here
+    // keeps the image alive until then
+    MappedFile* image = FindOrMap(FileId(info.st_dev, info.st_ino), fd, info.st_size);
+    close(fd);
+    if (image == nullptr) {
+        return Rom(nullptr, 0);
+    }
+    Rom rom(image);
+    image->Release();
+    return rom;
 }
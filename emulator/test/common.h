@@ -5,6 +5,8 @@
 #include <rom_static.h>
 #include <rom_loader.h>
 
+#include <cstring>
+
 struct MemoryTest : testing::Test {
     Frankenstein::Rom rom;
     Frankenstein::Nes nes;
@@ -41,3 +43,48 @@ struct RomTest : CPUTest {
     {
     }
 };
+
+/**
+ * Runs two consoles on the same ROM, the reference one catching up with the
+ * master clock of the tested one after each of its steps: both must reach
+ * the same CPU state at the same time, and the same RAM every ramInterval
+ * steps of the tested one.
+ */
+struct Lockstep {
+    u64 testedSteps = 0;
+    u64 referenceSteps = 0;
+    u32 ramInterval = 0; // 0 to only compare the CPU state
+
+    /**
+     * Runs until the tested console reaches frame
+     */
+    void Run(Frankenstein::Nes& tested, Frankenstein::Nes& reference, const u64 frame)
+    {
+        while (tested.ppu.Frame < frame) {
+            tested.Step();
+            testedSteps++;
+            while (reference.clock < tested.clock) {
+                reference.Step();
+                referenceSteps++;
+            }
+            const u64 step = testedSteps;
+            ASSERT_EQ(reference.clock, tested.clock) << "step " << step;
+            ASSERT_EQ(reference.cpu.registers.PC, tested.cpu.registers.PC) << "step " << step;
+            ASSERT_EQ(reference.cpu.registers.SP, tested.cpu.registers.SP) << "step " << step;
+            ASSERT_EQ(reference.cpu.registers.A, tested.cpu.registers.A) << "step " << step;
+            ASSERT_EQ(reference.cpu.registers.X, tested.cpu.registers.X) << "step " << step;
+            ASSERT_EQ(reference.cpu.registers.Y, tested.cpu.registers.Y) << "step " << step;
+            ASSERT_EQ(reference.cpu.GetStatus(), tested.cpu.GetStatus()) << "step " << step;
+            ASSERT_EQ(reference.cpu.cycles, tested.cpu.cycles) << "step " << step;
+
+            if (ramInterval != 0 && step % ramInterval == 0) {
+                for (u32 address = 0x0000; address < 0x0800; ++address) {
+                    ASSERT_EQ(reference.ram[address], tested.ram[address]) << "address " << address;
+                }
+                for (u32 address = 0x6000; address < 0x8000; ++address) {
+                    ASSERT_EQ(reference.ram[address], tested.ram[address]) << "address " << address;
+                }
+            }
+        }
+    }
+};
@@ -256,12 +256,13 @@ TEST_F(CPUTest, SBC_Overflow)
 TEST_F(CPUTest, DEC_ABS)
 {
     nes.cpu.registers.A = 0xFF;
-    nes.cpu.registers.PC = 0x8000;
-    nes.ram[0x8001] = 10;
-    nes.ram[0x8002] = 10;
+    nes.cpu.registers.PC = 0x0200;
+    nes.ram[0x0200] = 0xCE;
+    nes.ram[0x0201] = 10;
+    nes.ram[0x0202] = 10;
     nes.ram[nes.ram.Absolute(10, 10)] = 32;
 
-    nes.cpu.DEC_ABS();
+    nes.cpu.Step();
     
     EXPECT_EQ(31, nes.ram[nes.ram.Absolute(10, 10)]);
     EXPECT_FALSE(nes.cpu.Get<Cpu::Flags::Z>());
@@ -1036,4 +1037,97 @@ TEST_F(CPUTest, CPY_MinusOne_MinusOne)
     EXPECT_TRUE(nes.cpu.Get<Cpu::Flags::C>());
     EXPECT_TRUE(nes.cpu.Get<Cpu::Flags::Z>());
     EXPECT_FALSE(nes.cpu.Get<Cpu::Flags::S>());
-}
\ No newline at end of file
+}
+TEST_F(CPUTest, DecodeRamCodeAfterWrite)
+{
+    nes.cpu.registers.PC = 0x0200;
+    nes.ram[0x0200] = 0xA9; // LDA #$01
+    nes.ram[0x0201] = 0x01;
+    nes.cpu.Step();
+    EXPECT_EQ(0x01, nes.cpu.registers.A);
+
+    nes.cpu.registers.PC = 0x0200;
+    nes.ram[0x0201] = 0x02;
+    nes.cpu.Step();
+    EXPECT_EQ(0x02, nes.cpu.registers.A);
+}
+TEST_F(CPUTest, OamDmaStallsInOneStep)
+{
+    for (u16 i = 0; i < 256; ++i) {
+        nes.ram[0x0200 + i] = u8(i);
+    }
+    nes.ppu.oamAddress = 0x10;
+    nes.ram[0x4014] = 0x02;
+    for (u16 i = 0; i < 256; ++i) {
+        EXPECT_EQ(u8(i), nes.ppu.oamData[u8(0x10 + i)]);
+    }
+
+    const u16 stall = nes.cpu.stall;
+    EXPECT_TRUE(stall == 513 || stall == 514);
+    const u64 clock = nes.clock;
+    nes.Step();
+    EXPECT_EQ(0, nes.cpu.stall);
+    EXPECT_EQ(clock + stall * 3, nes.clock);
+}
+TEST_F(CPUTest, FetchReadsOnlyTheInstructionBytes)
+{
+    // BRK is read at $2001, reading two operand bytes would read $2002 and
+    // clear the vertical blank flag
+    nes.ppu.nmiOccurred = true;
+    nes.cpu.registers.PC = 0x2001;
+    nes.cpu.Step();
+    EXPECT_TRUE(nes.ppu.nmiOccurred);
+
+    // across the end of the RAM: LDA $0234, the high byte read at $0800
+    nes.ram[0x07FE] = 0xAD;
+    nes.ram[0x07FF] = 0x34;
+    nes.ram[0x0000] = 0x02;
+    nes.ram[0x0234] = 0x42;
+    nes.cpu.registers.PC = 0x07FE;
+    nes.cpu.Step();
+    EXPECT_EQ(0x42, nes.cpu.registers.A);
+    EXPECT_EQ(0x0801, nes.cpu.registers.PC);
+}
+
+// Runs a ROM with and without idle loop skipping: both must reach the same
+// state at the same time.
+static void RunIdleLoopLockstep(const char* file, const u64 frames)
+{
+    Rom rom(RomLoader::GetRom(file));
+    Nes skipping(rom);
+    Nes executing(rom);
+    executing.idleLoop.enabled = false;
+
+    Lockstep().Run(skipping, executing, frames);
+    executing.SyncPpu();
+    skipping.SyncPpu();
+    EXPECT_EQ(executing.ppu.Cycle, skipping.ppu.Cycle);
+    EXPECT_EQ(executing.ppu.ScanLine, skipping.ppu.ScanLine);
+    EXPECT_GT(skipping.idleLoop.skippedCycles, 0u);
+}
+
+// Runs a ROM with and without the fused instruction pairs: both must reach
+// the same state at the same time, in fewer steps when fused.
+static void RunFusionLockstep(const char* file, const u64 frames)
+{
+    Rom rom(RomLoader::GetRom(file));
+    Nes fused(rom);
+    Nes split(rom);
+    split.cpu.fusePairs = false;
+
+    Lockstep lockstep;
+    lockstep.Run(fused, split, frames);
+    EXPECT_LT(lockstep.testedSteps, lockstep.referenceSteps);
+}
+
+TEST(Fusion, SameStateAsSplit)
+{
+    RunFusionLockstep("roms/official_only.nes", 60);
+    RunFusionLockstep("roms/color_test.nes", 60);
+}
+
+TEST(IdleLoop, SameStateAsExecuting)
+{
+    RunIdleLoopLockstep("roms/03-immediate.nes", 30);
+    RunIdleLoopLockstep("roms/color_test.nes", 30);
+}
@@ -0,0 +1,87 @@
+#include "common.h"
+#include <frame_converter.h>
+
+#include <vector>
+
+using namespace Frankenstein;
+
+// The pixel of format for the system palette index of a pixel
+static std::vector<u8> ExpectedPixel(PixelFormat format, u8 index)
+{
+    const Ppu::RGBColor& c = Ppu::systemPalette[index & 0x3F];
+    switch (format) {
+    case PixelFormat::RGBA8888:
+        return { c.red, c.green, c.blue, 0xFF };
+    case PixelFormat::XRGB8888:
+        return { c.blue, c.green, c.red, 0xFF };
+    case PixelFormat::RGB565: {
+        const u16 word = u16((c.red >> 3) << 11 | (c.green >> 2) << 5 | c.blue >> 3);
+        return { u8(word), u8(word >> 8) };
+    }
+    case PixelFormat::Gray8:
+        return { u8((77 * c.red + 150 * c.green + 29 * c.blue + 128) >> 8) };
+    default:
+        return { u8(((66 * c.red + 129 * c.green + 25 * c.blue + 128) >> 8) + 16) };
+    }
+}
+
+TEST(FrameConverter, SameColorsAsThePalette)
+{
+    // every byte value, in vectors and in the tails not filling one
+    std::vector<u8> frame(Ppu::FramePixels);
+    for (u32 i = 0; i < frame.size(); ++i) {
+        frame[i] = u8(i * 7 + i / 251);
+    }
+    for (u8 f = 0; f < u8(PixelFormat::Count); ++f) {
+        const FrameConverter converter{ PixelFormat(f) };
+        const u32 bytes = FrameConverter::BytesPerPixel(converter.GetFormat());
+        for (u32 count : { Ppu::FramePixels, 999u, 31u, 17u, 0u }) {
+            std::vector<u8> out(count * bytes + 1, 0xA5);
+            converter.ConvertPixels(frame.data(), out.data(), count);
+            for (u32 i = 0; i < count; ++i) {
+                ASSERT_EQ(ExpectedPixel(converter.GetFormat(), frame[i]),
+                          std::vector<u8>(out.begin() + i * bytes, out.begin() + (i + 1) * bytes))
+                    << "format " << u32(f) << " pixel " << i << " of " << count;
+            }
+            ASSERT_EQ(0xA5, out.back());
+        }
+    }
+}
+
+TEST(FrameConverter, ChromaAveragesTheBlocks)
+{
+    std::vector<u8> frame(Ppu::FramePixels);
+    for (u32 i = 0; i < frame.size(); ++i) {
+        frame[i] = u8(i * 13 + i / 256);
+    }
+    const FrameConverter converter(PixelFormat::YUV420);
+    ASSERT_EQ(Ppu::FramePixels * 3 / 2, converter.FrameBytes());
+    std::vector<u8> out(converter.FrameBytes());
+    converter.Convert(frame.data(), out.data());
+
+    const auto u = [](u8 index) {
+        const Ppu::RGBColor& c = Ppu::systemPalette[index & 0x3F];
+        return ((-38 * c.red - 74 * c.green + 112 * c.blue + 128) >> 8) + 128;
+    };
+    const auto v = [](u8 index) {
+        const Ppu::RGBColor& c = Ppu::systemPalette[index & 0x3F];
+        return ((112 * c.red - 94 * c.green - 18 * c.blue + 128) >> 8) + 128;
+    };
+    const auto average = [](int a, int b) { return (a + b + 1) >> 1; };
+    const u32 width = Ppu::FrameWidth;
+    for (u32 y = 0; y < Ppu::FrameHeight; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            ASSERT_EQ(ExpectedPixel(PixelFormat::YUV420, frame[y * width + x])[0], out[y * width + x]);
+        }
+    }
+    for (u32 y = 0; y < Ppu::FrameHeight; y += 2) {
+        for (u32 x = 0; x < width; x += 2) {
+            const u8* block = &frame[y * width + x];
+            const u32 sample = Ppu::FramePixels + y / 2 * width / 2 + x / 2;
+            ASSERT_EQ(average(average(u(block[0]), u(block[width])), average(u(block[1]), u(block[width + 1]))),
+                      out[sample]);
+            ASSERT_EQ(average(average(v(block[0]), v(block[width])), average(v(block[1]), v(block[width + 1]))),
+                      out[sample + Ppu::FramePixels / 4]);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifdef CPU_JIT
+
+#include "common.h"
+
+#include <fstream>
+#include <string>
+
+using namespace Frankenstein;
+
+// Runs the same ROM translated and interpreted: both must reach the same
+// state at the same time.
+static void RunLockstep(const char* file)
+{
+    Rom rom(RomLoader::GetRom(file));
+    Nes jitted(rom);
+    Nes interpreted(rom);
+    jitted.EnableJit(true);
+
+    Lockstep lockstep;
+    lockstep.ramInterval = 1000;
+    lockstep.Run(jitted, interpreted, 60);
+    EXPECT_GT(jitted.jit->executedBlocks, 0u);
+}
+
+#define JIT_LOCKSTEP_TEST(name, file) \
+    TEST(JitLockstep, name)           \
+    {                                 \
+        RunLockstep(file);            \
+    }
+
+JIT_LOCKSTEP_TEST(Immediate, "roms/03-immediate.nes")
+JIT_LOCKSTEP_TEST(ZeroPage,  "roms/04-zero_page.nes")
+JIT_LOCKSTEP_TEST(ZpXY,      "roms/05-zp_xy.nes")
+JIT_LOCKSTEP_TEST(Absolute,  "roms/06-absolute.nes")
+JIT_LOCKSTEP_TEST(AbsXY,     "roms/07-abs_xy.nes")
+JIT_LOCKSTEP_TEST(Branches,  "roms/10-branches.nes")
+JIT_LOCKSTEP_TEST(Official,  "roms/official_only.nes")
+
+TEST(Jit, ArenaIsNeverWritableAndExecutable)
+{
+    Rom rom(RomLoader::GetRom("roms/official_only.nes"));
+    Nes nes(rom);
+    nes.EnableJit(true);
+    for (u32 frame = 0; frame < 30; ++frame) {
+        nes.RunFrame();
+    }
+    ASSERT_GT(nes.jit->translatedBlocks, 0u);
+
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        EXPECT_EQ(std::string::npos, line.find("rwx")) << line;
+    }
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "common.h"
+
+using namespace Frankenstein;
+
+TEST(Mapper0, IgnoresTheWritesToRom)
+{
+    Rom rom(RomLoader::GetRom("roms/01-basics.nes"));
+    ASSERT_EQ(0, rom.GetMapper());
+    Nes nes(rom);
+
+    const u8* banks[4];
+    memcpy(banks, nes.mapper->prgBanks, sizeof(banks));
+    const u8 first = nes.ram[0x8000];
+    nes.ram[0x8000] = 1;
+    nes.ram[0xC000] = 0;
+    for (u8 window = 0; window < 4; ++window) {
+        EXPECT_EQ(banks[window], nes.mapper->prgBanks[window]);
+    }
+    EXPECT_EQ(first, nes.ram[0x8000]);
+    EXPECT_EQ(rom.GetPRG()[0], nes.ram[0x8000]);
+}
+
+TEST(Mapper, InvalidImageLeavesTheSlotEmpty)
+{
+    // an MMC1 header with no PRG behind it
+    static u8 image[Rom::HeaderSize];
+    const u8 header[] = { 'N', 'E', 'S', 0x1A, 2, 1, 0x10 };
+    memcpy(image, header, sizeof(header));
+    Rom rom(image, sizeof(image));
+    ASSERT_FALSE(rom.IsValid());
+
+    Nes nes(rom);
+    EXPECT_EQ(0, nes.ram[0x8000]);
+    EXPECT_EQ(0, nes.ram[0xFFFC]);
+    nes.ram[0x8000] = 0x80;
+    EXPECT_EQ(Nes::StopReason::FrameComplete, nes.RunFrame());
+    EXPECT_EQ(0, nes.mapper->ReadCHR(0));
+}
+
+TEST(Mapper4, ScanlineIrq)
+{
+    // MMC3 cartridge: 32 KB of PRG, 8 KB of CHR, code in the last bank
+    static u8 image[Rom::HeaderSize + 0x8000 + 0x2000];
+    const u8 header[] = { 'N', 'E', 'S', 0x1A, 2, 1, 0x40 };
+    memcpy(image, header, sizeof(header));
+    u8* prg = image + Rom::HeaderSize;
+    const u8 reset[] = {
+        0xA9, 0x1E,         // LDA #$1E
+        0x8D, 0x01, 0x20,   // STA $2001: rendering on
+        0xA9, 0x0A,         // LDA #$0A
+        0x8D, 0x00, 0xC0,   // STA $C000: reload value
+        0x8D, 0x01, 0xC0,   // STA $C001: reload on the next scanline
+        0x8D, 0x01, 0xE0,   // STA $E001: IRQ enabled
+        0x58,               // CLI
+        0x4C, 0x11, 0xE0    // JMP *
+    };
+    const u8 irq[] = {
+        0x8D, 0x00, 0xE0,   // STA $E000: acknowledged
+        0x40                // RTI
+    };
+    memcpy(prg + 0x6000, reset, sizeof(reset));
+    memcpy(prg + 0x6100, irq, sizeof(irq));
+    prg[0x7FFC] = 0x00;
+    prg[0x7FFD] = 0xE0;
+    prg[0x7FFE] = 0x00;
+    prg[0x7FFF] = 0xE1;
+
+    Rom rom(image, sizeof(image));
+    Nes nes(rom);
+    nes.SetBreakpoint(0xE100);
+    EXPECT_EQ(Nes::StopReason::Breakpoint, nes.RunCycles(30000));
+
+    // reloaded on the pre-render line, the IRQ is raised on the 10th scanline
+    nes.SyncPpu();
+    EXPECT_EQ(9u, nes.ppu.ScanLine);
+    EXPECT_GE(nes.ppu.Cycle, 280u);
+    EXPECT_LT(nes.ppu.Cycle, 280u + 10 * 3);
+    EXPECT_TRUE(nes.cpu.Get<Cpu::Flags::I>());
+
+    // acknowledged and disabled by the handler
+    nes.ClearBreakpoint();
+    EXPECT_EQ(Nes::StopReason::BudgetExhausted, nes.RunCycles(30000));
+    EXPECT_EQ(0, nes.irqSources);
+}
+
+TEST(Mapper3, ChrSwitchMidFrame)
+{
+    // CNROM cartridge: tile 0 is blank in CHR bank 0 and opaque in bank 1
+    static u8 image[Rom::HeaderSize + PRGROM_BANK_SIZE + 2 * VROM_BANK_SIZE];
+    const u8 header[] = { 'N', 'E', 'S', 0x1A, 1, 2, 0x30 };
+    memcpy(image, header, sizeof(header));
+    u8* prg = image + Rom::HeaderSize;
+    const u8 reset[] = { 0x4C, 0x00, 0xC0 };   // JMP *
+    memcpy(prg, reset, sizeof(reset));
+    prg[0x3FFC] = 0x00;
+    prg[0x3FFD] = 0xC0;
+    memset(prg + PRGROM_BANK_SIZE + VROM_BANK_SIZE, 0xFF, 16);
+
+    Rom rom(image, sizeof(image));
+    Nes nes(rom);
+    nes.idleLoop.enabled = false;
+    EXPECT_EQ(Nes::StopReason::FrameComplete, nes.RunFrame());
+
+    // background color $0F, color 3 of the first palette $30, then the
+    // background on from the start of the next frame
+    const u8 setup[][2] = {
+        { 0x06, 0x3F }, { 0x06, 0x00 }, { 0x07, 0x0F },
+        { 0x06, 0x3F }, { 0x06, 0x03 }, { 0x07, 0x30 },
+        { 0x06, 0x00 }, { 0x06, 0x00 }, { 0x01, 0x0A }
+    };
+    for (const auto& write : setup) {
+        nes.ram[0x2000 + write[0]] = write[1];
+    }
+
+    // switches to bank 1 around the middle of the next frame
+    nes.RunCycles(15000);
+    const u8 code[] = {
+        0xA9, 0x01,         // LDA #$01
+        0x8D, 0x00, 0x80,   // STA $8000
+        0x4C, 0x05, 0x03    // JMP *
+    };
+    for (u16 i = 0; i < sizeof(code); ++i) {
+        nes.ram[0x0300 + i] = code[i];
+    }
+    nes.cpu.registers.PC = 0x0300;
+    nes.Step();
+    nes.Step();
+    nes.SyncPpu();
+    const u32 line = nes.ppu.ScanLine;
+    ASSERT_GT(line, 10u);
+    ASSERT_LT(line, 230u);
+
+    EXPECT_EQ(Nes::StopReason::FrameComplete, nes.RunFrame());
+    const u32 width = Ppu::FrameWidth;
+    EXPECT_EQ(0x0F, nes.ppu.front[(line - 2) * width + 100]);
+    EXPECT_EQ(0x30, nes.ppu.front[(line + 2) * width + 100]);
+}
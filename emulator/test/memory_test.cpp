@@ -105,3 +105,27 @@ TEST_F(MemoryTest, Addressing_PreIndexedIndirect)
     addr = nes.ram.PreIndexedIndirect(0xFF, 0x01);
     EXPECT_EQ((u16)0x0201, addr);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory Map Tests
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(MemoryTest, MemoryMap)
+{
+    // the 2 KB of internal RAM, mirrored up to $1FFF
+    nes.ram[0x0123] = 0x42;
+    EXPECT_EQ(0x42, nes.ram[0x0923]);
+    EXPECT_EQ(0x42, nes.ram[0x1923]);
+
+    // the 8 KB of cartridge RAM
+    nes.ram[0x6000] = 0x11;
+    nes.ram[0x7FFF] = 0x22;
+    EXPECT_EQ(0x11, nes.ram[0x6000]);
+    EXPECT_EQ(0x22, nes.ram[0x7FFF]);
+
+    // the expansion area is open bus
+    nes.ram[0x5000] = 0x33;
+    EXPECT_EQ(0x50, nes.ram[0x5000]);
+
+    // the PRG ROM is read in place from the cartridge
+    EXPECT_EQ(rom.GetPRG(), nes.ram.bus.ReadPage(0x8000));
+}
@@ -0,0 +1,147 @@
+#include "common.h"
+#include <batch_nes.h>
+
+using namespace Frankenstein;
+
+TEST(NesRun, RunFrameStopsAtVerticalBlank)
+{
+    Rom rom(RomLoader::GetRom("roms/color_test.nes"));
+    Nes nes(rom);
+    Nes stepped(rom);
+
+    for (u32 frame = 0; frame < 3; ++frame) {
+        EXPECT_EQ(Nes::StopReason::FrameComplete, nes.RunFrame());
+        EXPECT_TRUE(nes.ppu.vblankOccured);
+        EXPECT_EQ(241u, nes.ppu.ScanLine);
+
+        // the same instruction boundary as stepping until the vertical blank
+        bool vblank = stepped.ppu.vblankOccured;
+        while (!(stepped.ppu.vblankOccured && !vblank)) {
+            vblank = stepped.ppu.vblankOccured;
+            stepped.Step();
+        }
+        EXPECT_EQ(stepped.clock, nes.clock);
+        EXPECT_EQ(stepped.cpu.registers.PC, nes.cpu.registers.PC);
+    }
+}
+
+TEST(NesRun, RunCyclesStopsPastBudget)
+{
+    Rom rom(RomLoader::GetRom("roms/01-basics.nes"));
+    Nes nes(rom);
+
+    u64 start = nes.clock;
+    EXPECT_EQ(Nes::StopReason::BudgetExhausted, nes.RunCycles(10000));
+    EXPECT_GE(nes.clock, start + 10000 * 3);
+    EXPECT_LT(nes.clock, start + (10000 + 7) * 3);
+}
+
+TEST(NesRun, Breakpoint)
+{
+    Rom rom(RomLoader::GetRom("roms/01-basics.nes"));
+    Nes nes(rom);
+    Nes stepped(rom);
+
+    // the first instruction of the reset handler, executed once
+    u16 target = nes.cpu.registers.PC + nes.cpu.instructions[nes.cpu.OpCode()].size;
+    stepped.Step();
+    nes.SetBreakpoint(target);
+    EXPECT_EQ(Nes::StopReason::Breakpoint, nes.RunCycles(100000));
+    EXPECT_EQ(target, nes.cpu.registers.PC);
+    EXPECT_EQ(stepped.clock, nes.clock);
+
+    // resumes over the breakpoint
+    nes.ClearBreakpoint();
+    EXPECT_EQ(Nes::StopReason::BudgetExhausted, nes.RunCycles(10));
+    EXPECT_NE(target, nes.cpu.registers.PC);
+}
+
+TEST(NesRun, NmiEnabledInVerticalBlank)
+{
+    // NROM cartridge looping at the reset vector, NMI off
+    static u8 image[Rom::HeaderSize + PRGROM_BANK_SIZE];
+    const u8 header[] = { 'N', 'E', 'S', 0x1A, 1, 0 };
+    memcpy(image, header, sizeof(header));
+    u8* prg = image + Rom::HeaderSize;
+    const u8 reset[] = { 0x4C, 0x00, 0xC0 };   // JMP *
+    memcpy(prg, reset, sizeof(reset));
+    prg[0x0100] = 0x40;                         // RTI
+    prg[0x3FFA] = 0x00;
+    prg[0x3FFB] = 0xC1;
+    prg[0x3FFC] = 0x00;
+    prg[0x3FFD] = 0xC0;
+
+    Rom rom(image, sizeof(image));
+    Nes nes(rom);
+    nes.idleLoop.enabled = false;
+    EXPECT_EQ(Nes::StopReason::FrameComplete, nes.RunFrame());
+    nes.RunCycles(300);
+    nes.SyncPpu();
+    ASSERT_TRUE(nes.ppu.nmiOccurred);
+
+    // turns the NMI on in the middle of the vertical blank
+    const u8 code[] = {
+        0xA9, 0x80,         // LDA #$80
+        0x8D, 0x00, 0x20,   // STA $2000
+        0x4C, 0x05, 0x03    // JMP *
+    };
+    for (u16 i = 0; i < sizeof(code); ++i) {
+        nes.ram[0x0300 + i] = code[i];
+    }
+    nes.cpu.registers.PC = 0x0300;
+    nes.Step();
+    nes.Step();
+    ASSERT_EQ(0x0305, nes.cpu.registers.PC);
+    const u64 written = nes.clock;
+
+    // taken after the NMI delay and the instruction running then
+    nes.SetBreakpoint(0xC100);
+    EXPECT_EQ(Nes::StopReason::Breakpoint, nes.RunCycles(30000));
+    EXPECT_LT(nes.clock - written, 15u + 3 * 3 + 7 * 3);
+}
+
+TEST(NesRun, ScheduleMovesTheDeadline)
+{
+    Rom rom(RomLoader::GetRom("roms/01-basics.nes"));
+    Nes nes(rom);
+    nes.RunCycles(1000);
+    ASSERT_GT(nes.deadline, nes.clock + 30);
+
+    // queued from the CPU side, between two catch ups of the PPU
+    const u64 time = nes.clock + 30;
+    nes.Schedule(EventQueue::Event::MapperCounter, time);
+    EXPECT_EQ(time, nes.deadline);
+    nes.Schedule(EventQueue::Event::MapperCounter, time + 300);
+    EXPECT_EQ(time, nes.deadline);
+}
+
+TEST(BatchNes, LanesRunAsIndependentConsoles)
+{
+    Rom rom(RomLoader::GetRom("roms/official_only.nes"));
+    const u32 lanes = 3;
+    BatchNes batch(rom, lanes);
+    Nes a(rom), b(rom), c(rom);
+    Nes* alone[lanes] = { &a, &b, &c };
+
+    for (u32 frame = 0; frame < 30; ++frame) {
+        for (u32 lane = 0; lane < lanes; ++lane) {
+            // a different button pattern on each lane
+            const u8 buttons = u8((frame / 4 + lane) * 0x25);
+            batch.SetButtons(lane, buttons);
+            for (u8 button = 0; button < 8; ++button) {
+                alone[lane]->pad1.buttons[button] = (buttons >> button) & 1;
+            }
+            alone[lane]->RunFrame();
+        }
+        batch.StepAll();
+
+        for (u32 lane = 0; lane < lanes; ++lane) {
+            Nes& nes = batch.Lane(lane);
+            ASSERT_EQ(alone[lane]->clock, nes.clock);
+            ASSERT_EQ(alone[lane]->cpu.registers.PC, nes.cpu.registers.PC);
+            for (u16 address = 0; address < 0x800; ++address) {
+                ASSERT_EQ(u8(alone[lane]->ram[address]), u8(nes.ram[address]));
+            }
+        }
+    }
+}
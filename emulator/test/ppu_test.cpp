@@ -0,0 +1,192 @@
+#include "common.h"
+
+using namespace Frankenstein;
+
+// With rendering on, the odd frames skip a dot: the deadlines are exact
+// across both frame parities
+TEST(PpuDeadline, ReachesTheEventsExactly)
+{
+    Rom rom(RomLoader::GetRom("roms/color_test.nes"));
+    Nes nes(rom);
+    nes.ppu.flagShowBackground = 1;
+
+    for (u32 span = 0; span < 12; ++span) {
+        nes.ppu.Run(nes.ppu.DotsUntilEvent());
+        EXPECT_EQ(1u, nes.ppu.Cycle) << "span " << span;
+        EXPECT_TRUE(nes.ppu.ScanLine == 241 || nes.ppu.ScanLine == 261) << "span " << span;
+    }
+    for (u32 line = 0; line < 262 * 4; ++line) {
+        nes.ppu.Run(nes.ppu.DotsUntilCycle(280));
+        EXPECT_EQ(280u, nes.ppu.Cycle) << "line " << line;
+    }
+}
+
+// Runs a ROM with the PPU rendering a scanline at a time and a dot at a time:
+// both must reach the same state at the same time and produce the same
+// frames.
+static void RunScanlineLockstep(const char* file, const u64 frames)
+{
+    Rom rom(RomLoader::GetRom(file));
+    Nes lines(rom);
+    Nes dots(rom);
+    dots.ppu.renderLines = false;
+
+    Lockstep lockstep;
+    for (u64 frame = 1; frame <= frames; ++frame) {
+        lockstep.Run(lines, dots, frame);
+        ASSERT_FALSE(testing::Test::HasFatalFailure()) << file;
+        lines.SyncPpu();
+        dots.SyncPpu();
+        ASSERT_EQ(0, memcmp(dots.ppu.front, lines.ppu.front, Ppu::FramePixels))
+            << file << " frame " << frame;
+    }
+}
+
+TEST(PpuScanline, SameFramesAsDots)
+{
+    const char* const roms[] = {
+        "roms/01-basics.nes", "roms/02-implied.nes", "roms/03-immediate.nes",
+        "roms/04-zero_page.nes", "roms/05-zp_xy.nes", "roms/06-absolute.nes",
+        "roms/07-abs_xy.nes", "roms/08-ind_x.nes", "roms/09-ind_y.nes",
+        "roms/10-branches.nes", "roms/11-stack.nes", "roms/12-jmp_jsr.nes",
+        "roms/13-rts.nes", "roms/14-rti.nes", "roms/15-brk.nes",
+        "roms/16-special.nes", "roms/color_test.nes", "roms/full_nes_palette.nes",
+        "roms/official_only.nes"
+    };
+    for (const char* file : roms) {
+        RunScanlineLockstep(file, 30);
+    }
+}
+
+// Decodes a row of pattern bytes a pixel at a time, leftmost pixel first
+static u32 DecodeRow(u8 low, u8 high, const u8 attribute, const bool flip)
+{
+    u32 data = 0;
+    for (u8 i = 0; i < 8; i++) {
+        const u8 bit = flip ? i : 7 - i;
+        data <<= 4;
+        data |= u32(attribute | ((low >> bit) & 1) | (((high >> bit) & 1) << 1));
+    }
+    return data;
+}
+
+TEST(PpuPatterns, SameRowsAsDecodingEachPixel)
+{
+    Rom rom(RomLoader::GetRom("roms/color_test.nes"));
+    Nes nes(rom);
+    Ppu& ppu = nes.ppu;
+
+    for (u16 tile = 0; tile < 256; tile += 7) {
+        for (u8 row = 0; row < 8; ++row) {
+            const u16 address = tile * 16 + row;
+            const u8 low = nes.mapper->ReadCHR(address);
+            const u8 high = nes.mapper->ReadCHR(address + 8);
+
+            // background, with the attribute of the tile
+            ppu.tileData = 0;
+            ppu.lowTileByte = low;
+            ppu.highTileByte = high;
+            ppu.attributeTableByte = u8((tile & 3) << 2);
+            ppu.storeTileData();
+            ASSERT_EQ(DecodeRow(low, high, u8((tile & 3) << 2), false), u32(ppu.tileData));
+
+            // sprites, flipped or not
+            ppu.flagSpriteSize = 0;
+            ppu.flagSpriteTable = 0;
+            for (u8 attributes : { 0x00, 0x41, 0x02, 0x43 }) {
+                ppu.oamData[1] = u8(tile);
+                ppu.oamData[2] = attributes;
+                ASSERT_EQ(DecodeRow(low, high, u8((attributes & 3) << 2), attributes & 0x40),
+                          ppu.fetchSpritePattern(0, row));
+            }
+        }
+    }
+}
+
+TEST(PpuSprites, LineHoldsTheFrontmostOpaquePixel)
+{
+    Rom rom(RomLoader::GetRom("roms/color_test.nes"));
+    Nes nes(rom);
+    Ppu& ppu = nes.ppu;
+
+    // ten overlapping sprites on line 20, the last two over the limit
+    ppu.flagSpriteSize = 0;
+    ppu.flagSpriteTable = 0;
+    memset(ppu.oamData, 0xFF, sizeof(ppu.oamData));
+    for (u8 i = 0; i < 10; ++i) {
+        ppu.oamData[i * 4 + 0] = u8(14 + i % 5);
+        ppu.oamData[i * 4 + 1] = u8(i * 13 + 1);
+        ppu.oamData[i * 4 + 2] = u8((i & 3) | (i % 3 == 0 ? 0x20 : 0) | (i & 4 ? 0x40 : 0));
+        ppu.oamData[i * 4 + 3] = u8(i == 7 ? 252 : i * 5);
+    }
+    ppu.oamDirty = true;
+    ppu.ScanLine = 20;
+    ppu.evaluateSprites();
+    ASSERT_EQ(8u, ppu.spriteCount);
+    ASSERT_EQ(1, ppu.flagSpriteOverflow);
+
+    for (u32 x = 0; x < 256; ++x) {
+        u8 expected = 0;
+        for (u8 i = 0; i < 8; ++i) {
+            const u32 offset = x - ppu.oamData[i * 4 + 3];
+            if (offset > 7) {
+                continue;
+            }
+            const u32 row = 20 - ppu.oamData[i * 4 + 0];
+            const u8 color = u8((ppu.fetchSpritePattern(i, row) >> ((7 - offset) * 4)) & 0x0F);
+            if ((color & 0x03) != 0) {
+                expected = color | ((ppu.oamData[i * 4 + 2] & 0x20) != 0 ? Ppu::SpriteBehind : 0) |
+                    (i == 0 ? Ppu::SpriteZero : 0);
+                break;
+            }
+        }
+        ASSERT_EQ(expected, ppu.spriteLine[x]) << "x " << x;
+    }
+
+    // a line without sprites clears the buffer
+    ppu.ScanLine = 100;
+    ppu.evaluateSprites();
+    ASSERT_EQ(0u, ppu.spriteCount);
+    for (u32 x = 0; x < 256; ++x) {
+        ASSERT_EQ(0, ppu.spriteLine[x]);
+    }
+}
+
+TEST(PpuSprites, IndexFollowsOamAndSpriteSize)
+{
+    Rom rom(RomLoader::GetRom("roms/color_test.nes"));
+    Nes nes(rom);
+    Ppu& ppu = nes.ppu;
+
+    // all the sprites below the screen, then nine of them from line 50
+    ppu.oamAddress = 0;
+    for (u32 i = 0; i < 256; ++i) {
+        ppu.writeOAMData(i % 4 == 0 && i < 9 * 4 ? 50 : 0xFF);
+    }
+    ppu.writeControl(0x00);
+    ppu.ScanLine = 57;
+    ppu.evaluateSprites();
+    ASSERT_EQ(8u, ppu.spriteCount);
+    ASSERT_EQ(1, ppu.flagSpriteOverflow);
+
+    // 8x16 sprites reach further down
+    ppu.flagSpriteOverflow = 0;
+    ppu.ScanLine = 58;
+    ppu.evaluateSprites();
+    ASSERT_EQ(0u, ppu.spriteCount);
+    ppu.writeControl(0x20);
+    ppu.evaluateSprites();
+    ASSERT_EQ(8u, ppu.spriteCount);
+    ASSERT_EQ(1, ppu.flagSpriteOverflow);
+
+    // moving a sprite away leaves eight on the line, without overflow
+    ppu.flagSpriteOverflow = 0;
+    ppu.oamAddress = 0;
+    ppu.writeOAMData(100);
+    ppu.evaluateSprites();
+    ASSERT_EQ(8u, ppu.spriteCount);
+    ASSERT_EQ(0, ppu.flagSpriteOverflow);
+    ppu.ScanLine = 101;
+    ppu.evaluateSprites();
+    ASSERT_EQ(1u, ppu.spriteCount);
+}
@@ -0,0 +1,78 @@
+#include "common.h"
+
+#include <string>
+
+using namespace Frankenstein;
+
+// The test status is written to $6000. $80 means the test is running, $81
+// means the test needs the reset button pressed. $00-$7F means the test has
+// completed and given that result code. $DE $B0 $61 is written to $6001-$6003
+// once the data at $6000+ is valid. The text output is written at $6004.
+static u8 RunTestRom(const std::string& file, std::string& message)
+{
+    Rom rom(RomLoader::GetRom(file));
+    Nes nes(rom);
+
+    for (u32 i = 0; i < 5000000; ++i) {
+        nes.Step();
+        if (nes.ram[0x6000] < 0x80 &&
+            nes.ram[0x6001] == 0xDE &&
+            nes.ram[0x6002] == 0xB0 &&
+            nes.ram[0x6003] == 0x61) {
+            for (u16 j = 0x6004; j < 0x8000 && nes.ram[j] != 0; ++j) {
+                message += char(nes.ram[j]);
+            }
+            return nes.ram[0x6000];
+        }
+    }
+    message = "timed out";
+    return 0xFF;
+}
+
+#define BLARGG_ROM_TEST(name, file)           \
+    TEST(BlarggRom, name)                     \
+    {                                         \
+        std::string message;                  \
+        u8 status = RunTestRom(file, message);\
+        EXPECT_EQ(0, status) << message;      \
+    }
+
+BLARGG_ROM_TEST(Basics,   "roms/01-basics.nes")
+BLARGG_ROM_TEST(Implied,  "roms/02-implied.nes")
+BLARGG_ROM_TEST(Branches, "roms/10-branches.nes")
+BLARGG_ROM_TEST(Stack,    "roms/11-stack.nes")
+BLARGG_ROM_TEST(JmpJsr,   "roms/12-jmp_jsr.nes")
+BLARGG_ROM_TEST(Rts,      "roms/13-rts.nes")
+BLARGG_ROM_TEST(Rti,      "roms/14-rti.nes")
+BLARGG_ROM_TEST(Brk,      "roms/15-brk.nes")
+BLARGG_ROM_TEST(Special,  "roms/16-special.nes")
+
+TEST(RomLoader, SharesTheMapping)
+{
+    Rom first(RomLoader::GetRom("roms/01-basics.nes"));
+    Rom second(RomLoader::GetRom("roms/01-basics.nes"));
+    ASSERT_TRUE(first.IsValid());
+    EXPECT_EQ(first.GetRaw(), second.GetRaw());
+    EXPECT_EQ(first.GetRaw() + Rom::HeaderSize, first.GetPRG());
+    EXPECT_EQ(first.GetPRG() + first.GetHeader().prgRomBanks * PRGROM_BANK_SIZE, first.GetCHR());
+
+    Rom copy(first);
+    EXPECT_EQ(first.GetPRG(), copy.GetPRG());
+}
+
+TEST(RomLoader, RejectsInvalidImages)
+{
+    EXPECT_FALSE(RomLoader::GetRom("roms/missing.nes").IsValid());
+
+    // not an iNES header
+    const u8 text[Rom::HeaderSize + 16] = "not a cartridge";
+    EXPECT_FALSE(Rom(text, sizeof(text)).IsValid());
+
+    // shorter than the banks of its header
+    static u8 image[Rom::HeaderSize + PRGROM_BANK_SIZE];
+    const u8 header[] = { 'N', 'E', 'S', 0x1A, 1, 1 };
+    memcpy(image, header, sizeof(header));
+    EXPECT_FALSE(Rom(image, sizeof(image)).IsValid());
+    image[5] = 0;
+    EXPECT_TRUE(Rom(image, sizeof(image)).IsValid());
+}
@@ -4,6 +4,9 @@
 #include "kernel.h"
 static const char FromKernel[] = "kernel";
 
+static_assert(DEPTH == 16 || DEPTH == 32, "the screen must have 16 or 32 bits per pixel");
+static const PixelFormat ScreenFormat = DEPTH == 16 ? PixelFormat::RGB565 : PixelFormat::XRGB8888;
+
 Nes* CKernel::s_nes = nullptr;
 CLogger* CKernel::s_logger = nullptr;
 CInterruptSystem* CKernel::s_interrupt = nullptr;
@@ -16,8 +19,17 @@ CKernel::CKernel(void)
     , m_Logger(m_Options.GetLogLevel(), &m_Timer)
     , m_DWHCI(&m_Interrupt, &m_Timer)
     , embedded_rom(Frankenstein::StaticRom::raw, Frankenstein::StaticRom::length)
-    , nes(embedded_rom, &m_Screen)
+    , nes(embedded_rom)
 {
+    // draws the whole first frame
+    memset(displayed, 0xFF, sizeof(displayed));
+
+    u8 indexes[64];
+    for (u8 i = 0; i < 64; i++) {
+        indexes[i] = i;
+    }
+    FrameConverter(ScreenFormat).ConvertPixels(indexes, colors, 64);
+
     CKernel::s_logger = &m_Logger;
     CKernel::s_interrupt = &m_Interrupt;
 
@@ -118,32 +130,52 @@ TShutdownMode CKernel::Run(void)
     m_Logger.Write(FromKernel, LogNotice, "Use your gamepad controls!");
 
     while (true) {
-        nes.Step();
-        if (nes.cpu.nmiOccurred) {
-            nes.pad1.buttons[Gamepad::ButtonIndex::A]      = s_input_player1.buttons & 0x80;
-            nes.pad1.buttons[Gamepad::ButtonIndex::B]      = s_input_player1.buttons & 0x40;
-            nes.pad1.buttons[Gamepad::ButtonIndex::Select] = s_input_player1.buttons & 0x10;
-            nes.pad1.buttons[Gamepad::ButtonIndex::Start]  = s_input_player1.buttons & 0x20;
-            nes.pad1.buttons[Gamepad::ButtonIndex::Up]     = !s_input_player1.axes[1].value;
-            nes.pad1.buttons[Gamepad::ButtonIndex::Down]   = s_input_player1.axes[1].value == 255;
-            nes.pad1.buttons[Gamepad::ButtonIndex::Left]   = !s_input_player1.axes[0].value;
-            nes.pad1.buttons[Gamepad::ButtonIndex::Right]  = s_input_player1.axes[0].value == 255;
-
-            nes.pad2.buttons[Gamepad::ButtonIndex::A]      = s_input_player2.buttons & 0x80;
-            nes.pad2.buttons[Gamepad::ButtonIndex::B]      = s_input_player2.buttons & 0x40;
-            nes.pad2.buttons[Gamepad::ButtonIndex::Select] = s_input_player2.buttons & 0x10;
-            nes.pad2.buttons[Gamepad::ButtonIndex::Start]  = s_input_player2.buttons & 0x20;
-            nes.pad2.buttons[Gamepad::ButtonIndex::Up]     = !s_input_player2.axes[1].value;
-            nes.pad2.buttons[Gamepad::ButtonIndex::Down]   = s_input_player2.axes[1].value == 255;
-            nes.pad2.buttons[Gamepad::ButtonIndex::Left]   = !s_input_player2.axes[0].value;
-            nes.pad2.buttons[Gamepad::ButtonIndex::Right]  = s_input_player2.axes[0].value == 255;
-
-            m_Interrupt.EnableIRQ(ARM_IRQ_USB);
-        }
+        nes.RunFrame();
+        DrawFrame();
+
+        // the pads are read once per frame
+        nes.pad1.buttons[Gamepad::ButtonIndex::A]      = s_input_player1.buttons & 0x80;
+        nes.pad1.buttons[Gamepad::ButtonIndex::B]      = s_input_player1.buttons & 0x40;
+        nes.pad1.buttons[Gamepad::ButtonIndex::Select] = s_input_player1.buttons & 0x10;
+        nes.pad1.buttons[Gamepad::ButtonIndex::Start]  = s_input_player1.buttons & 0x20;
+        nes.pad1.buttons[Gamepad::ButtonIndex::Up]     = !s_input_player1.axes[1].value;
+        nes.pad1.buttons[Gamepad::ButtonIndex::Down]   = s_input_player1.axes[1].value == 255;
+        nes.pad1.buttons[Gamepad::ButtonIndex::Left]   = !s_input_player1.axes[0].value;
+        nes.pad1.buttons[Gamepad::ButtonIndex::Right]  = s_input_player1.axes[0].value == 255;
+
+        nes.pad2.buttons[Gamepad::ButtonIndex::A]      = s_input_player2.buttons & 0x80;
+        nes.pad2.buttons[Gamepad::ButtonIndex::B]      = s_input_player2.buttons & 0x40;
+        nes.pad2.buttons[Gamepad::ButtonIndex::Select] = s_input_player2.buttons & 0x10;
+        nes.pad2.buttons[Gamepad::ButtonIndex::Start]  = s_input_player2.buttons & 0x20;
+        nes.pad2.buttons[Gamepad::ButtonIndex::Up]     = !s_input_player2.axes[1].value;
+        nes.pad2.buttons[Gamepad::ButtonIndex::Down]   = s_input_player2.axes[1].value == 255;
+        nes.pad2.buttons[Gamepad::ButtonIndex::Left]   = !s_input_player2.axes[0].value;
+        nes.pad2.buttons[Gamepad::ButtonIndex::Right]  = s_input_player2.axes[0].value == 255;
+
+        m_Interrupt.EnableIRQ(ARM_IRQ_USB);
     }
     return ShutdownHalt;
 }
 
+void CKernel::DrawFrame(void)
+{
+    // the pixels are drawn twice as large
+    const u8* frame = nes.ppu.front;
+    for (unsigned i = 0; i < Ppu::FramePixels; i++) {
+        if (frame[i] == displayed[i]) {
+            continue;
+        }
+        displayed[i] = frame[i];
+        TScreenColor col = colors[frame[i] & 0x3F];
+        unsigned x = i % Ppu::FrameWidth;
+        unsigned y = i / Ppu::FrameWidth;
+        m_Screen.SetPixel(x * 2, y * 2, col);
+        m_Screen.SetPixel(x * 2 + 1, y * 2, col);
+        m_Screen.SetPixel(x * 2, y * 2 + 1, col);
+        m_Screen.SetPixel(x * 2 + 1, y * 2 + 1, col);
+    }
+}
+
 void CKernel::GamePadStatusHandler(unsigned nDeviceIndex, const TGamePadState* pState)
 {
     if(nDeviceIndex == 0) {
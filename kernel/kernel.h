@@ -19,6 +19,7 @@
 #include <circle/types.h>
 #include <circle/util.h>
 
+#include "../emulator/include/frame_converter.h"
 #include "../emulator/include/nes.h"
 #include "../emulator/include/rom_static.h"
 
@@ -43,6 +44,7 @@ public:
     
 private:
     static void GamePadStatusHandler (unsigned nDeviceIndex, const TGamePadState *pState);
+    void DrawFrame (void);
     static CLogger* s_logger;
     static Nes* s_nes;
     static TGamePadState s_input_player1;
@@ -66,6 +68,8 @@ private:
     // TODO: add more members here
     Rom embedded_rom;
     Nes nes;
+    u8 displayed[Ppu::FramePixels]; // frame on the screen, for drawing only what changed
+    TScreenColor colors[64];        // the system palette in the format of the screen
     
 };
 